@@ -31,5 +31,7 @@
 #include "hal/include/hal_adc_sync.h"
 
 void samd_peripherals_adc_setup(struct adc_sync_descriptor *adc, Adc *instance);
+// Gates the ADC's clocks once adc_sync_deinit() has run.
+void samd_peripherals_adc_release(Adc *instance);
 
 #endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_ADC_H
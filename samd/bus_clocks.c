@@ -0,0 +1,139 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/bus_clocks.h"
+
+#include "samd/clocks.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+static uint16_t bus_clock_counts[BUS_COUNT][32];
+static uint16_t gclk_channel_counts[GCLK_NUM];
+static uint8_t gclk_channel_generators[GCLK_NUM];
+// Channels set up through gclk_channel_connect().
+static uint64_t connected_channels;
+
+// Claiming never wraps a count back to zero. A count that reaches CLOCK_USERS_PINNED has lost track
+// of its users, usually because of claims that are never released, so its clock stays on for good.
+static bool count_claim(uint16_t* count) {
+    if (*count == CLOCK_USERS_PINNED) {
+        return false;
+    }
+    return (*count)++ == 0;
+}
+
+static bool count_release(uint16_t* count) {
+    if (*count == 0 || *count == CLOCK_USERS_PINNED) {
+        return false;
+    }
+    return --(*count) == 0;
+}
+
+void bus_clock_claim(uint8_t bus, uint32_t mask) {
+    uint8_t bit = __builtin_ctz(mask);
+    common_hal_mcu_disable_interrupts();
+    if (count_claim(&bus_clock_counts[bus][bit])) {
+        set_bus_clock(bus, mask, true);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+void bus_clock_release(uint8_t bus, uint32_t mask) {
+    uint8_t bit = __builtin_ctz(mask);
+    common_hal_mcu_disable_interrupts();
+    if (count_release(&bus_clock_counts[bus][bit])) {
+        set_bus_clock(bus, mask, false);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint16_t bus_clock_users(uint8_t bus, uint32_t mask) {
+    return bus_clock_counts[bus][__builtin_ctz(mask)];
+}
+
+void bus_clock_pin(uint8_t bus, uint32_t mask) {
+    common_hal_mcu_disable_interrupts();
+    bus_clock_counts[bus][__builtin_ctz(mask)] = CLOCK_USERS_PINNED;
+    set_bus_clock(bus, mask, true);
+    common_hal_mcu_enable_interrupts();
+}
+
+bool gclk_channel_claim(uint8_t gclk, uint8_t peripheral) {
+    common_hal_mcu_disable_interrupts();
+    uint16_t* count = &gclk_channel_counts[peripheral];
+    if (*count != 0 && gclk_channel_generators[peripheral] != gclk) {
+        common_hal_mcu_enable_interrupts();
+        return false;
+    }
+    if (count_claim(count)) {
+        gclk_channel_generators[peripheral] = gclk;
+        connect_gclk_to_peripheral(gclk, peripheral);
+    }
+    common_hal_mcu_enable_interrupts();
+    return true;
+}
+
+void gclk_channel_release(uint8_t peripheral) {
+    common_hal_mcu_disable_interrupts();
+    if (count_release(&gclk_channel_counts[peripheral]) &&
+        (connected_channels & (1ULL << peripheral)) == 0) {
+        disconnect_gclk_from_peripheral(gclk_channel_generators[peripheral], peripheral);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint16_t gclk_channel_users(uint8_t peripheral) {
+    return gclk_channel_counts[peripheral];
+}
+
+void gclk_channel_connect(uint8_t gclk, uint8_t peripheral) {
+    common_hal_mcu_disable_interrupts();
+    connected_channels |= 1ULL << peripheral;
+    gclk_channel_generators[peripheral] = gclk;
+    connect_gclk_to_peripheral(gclk, peripheral);
+    common_hal_mcu_enable_interrupts();
+}
+
+void bus_clocks_get_report(bus_clocks_report_t* report) {
+    common_hal_mcu_disable_interrupts();
+    for (uint8_t bus = 0; bus < BUS_COUNT; bus++) {
+        uint32_t claimed = 0;
+        for (uint8_t bit = 0; bit < 32; bit++) {
+            if (bus_clock_counts[bus][bit] > 0) {
+                claimed |= 1UL << bit;
+            }
+        }
+        report->claimed[bus] = claimed;
+        report->running[bus] = get_bus_clocks(bus);
+    }
+    report->channels = connected_channels;
+    for (uint8_t i = 0; i < GCLK_NUM; i++) {
+        if (gclk_channel_counts[i] > 0) {
+            report->channels |= 1ULL << i;
+        }
+    }
+    common_hal_mcu_enable_interrupts();
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_BUS_CLOCKS_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_BUS_CLOCKS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+// Refcounted peripheral clocks. The first claim turns a clock on and the last release gates it
+// again so peripherals that nobody is using don't draw current. Bus clocks are the AHB and APB
+// masks in PM on the SAMD21 and MCLK on the SAM_D5X_E5X and are named by the mask bit, such as
+// bus_clock_claim(BUS_APBA, MCLK_APBAMASK_EIC). Generic clock channels are the GCLK CLKCTRL or
+// PCHCTRL IDs. Release a peripheral's generic clock before its bus clock because its registers
+// can't be reached without the bus clock.
+typedef enum {
+    BUS_AHB,
+    BUS_APBA,
+    BUS_APBB,
+    BUS_APBC,
+    #ifdef SAM_D5X_E5X
+    BUS_APBD,
+    #endif
+    BUS_COUNT
+} bus_t;
+
+// Counts stop at CLOCK_USERS_PINNED rather than wrapping and the clock then stays on for good.
+#define CLOCK_USERS_PINNED 0xffff
+
+void bus_clock_claim(uint8_t bus, uint32_t mask);
+void bus_clock_release(uint8_t bus, uint32_t mask);
+uint16_t bus_clock_users(uint8_t bus, uint32_t mask);
+// For callers that never release. The clock stays on for good.
+void bus_clock_pin(uint8_t bus, uint32_t mask);
+
+// Returns false without claiming when claims already have the channel on another generator.
+// Connects that were never claimed don't count so a claim moves the channel off them.
+bool gclk_channel_claim(uint8_t gclk, uint8_t peripheral);
+void gclk_channel_release(uint8_t peripheral);
+uint16_t gclk_channel_users(uint8_t peripheral);
+// For callers that never release. The last connect wins, even over claims, and the channel is never
+// disconnected after that because its connector may still be using it.
+void gclk_channel_connect(uint8_t gclk, uint8_t peripheral);
+
+typedef struct {
+    uint32_t claimed[BUS_COUNT];  // Bus clocks with at least one user.
+    uint32_t running[BUS_COUNT];  // Everything that's on, including what's never been claimed.
+    uint64_t channels;            // Generic clock channels with at least one claim or connect.
+} bus_clocks_report_t;
+
+void bus_clocks_get_report(bus_clocks_report_t* report);
+
+// Provided by the chip specific clocks.c.
+void set_bus_clock(uint8_t bus, uint32_t mask, bool enable);
+uint32_t get_bus_clocks(uint8_t bus);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_BUS_CLOCKS_H
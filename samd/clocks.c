@@ -26,14 +26,15 @@
 
 #include "clocks.h"
 
+#include "bus_clocks.h"
+
 #include "hpl_gclk_config.h"
 
 #include "shared-bindings/microcontroller/__init__.h"
 
 #include "py/runtime.h"
 
-// TODO(tannewt): Should we have a way of sharing GCLKs based on their speed? Divisor doesn't
-// gaurantee speed because it depends on the source.
+// Use claim_gclk() to share generators with others that run at the same speed.
 uint8_t find_free_gclk(uint16_t divisor) {
     if (divisor > 0xff) {
         if (gclk_enabled(1)) {
@@ -58,6 +59,123 @@ uint8_t find_free_gclk(uint16_t divisor) {
 
 static uint8_t last_static_clock = 0;
 
+typedef struct {
+    void (*callback)(void* context, clock_change_t change);
+    void* context;
+} clock_notifier_t;
+
+static clock_notifier_t clock_notifiers[CLOCK_CHANGE_NOTIFIERS];
+
+bool clock_add_notifier(void (*callback)(void* context, clock_change_t change), void* context) {
+    for (uint8_t i = 0; i < CLOCK_CHANGE_NOTIFIERS; i++) {
+        clock_notifier_t* notifier = &clock_notifiers[i];
+        if (notifier->callback == NULL) {
+            notifier->context = context;
+            notifier->callback = callback;
+            return true;
+        }
+    }
+    return false;
+}
+
+void clock_remove_notifier(void (*callback)(void* context, clock_change_t change), void* context) {
+    for (uint8_t i = 0; i < CLOCK_CHANGE_NOTIFIERS; i++) {
+        clock_notifier_t* notifier = &clock_notifiers[i];
+        if (notifier->callback == callback && notifier->context == context) {
+            notifier->callback = NULL;
+        }
+    }
+}
+
+void clock_notify(clock_change_t change) {
+    for (uint8_t i = 0; i < CLOCK_CHANGE_NOTIFIERS; i++) {
+        clock_notifier_t* notifier = &clock_notifiers[i];
+        if (notifier->callback != NULL) {
+            notifier->callback(notifier->context, change);
+        }
+    }
+}
+static uint8_t gclk_users[GCLK_GEN_NUM];
+
+static bool gclk_fixed(uint8_t gclk) {
+    return gclk == CORE_GCLK || gclk <= last_static_clock;
+}
+
+// Generators that change speed with the performance level can't be shared by frequency.
+static bool gclk_variable(uint8_t gclk) {
+    #ifdef SAM_D5X_E5X
+    if (gclk_get_source(gclk) == GCLK_GENCTRL_SRC_DPLL0_Val) {
+        return true;
+    }
+    #endif
+    return gclk == CORE_GCLK;
+}
+
+uint8_t claim_gclk(uint8_t source, uint16_t divisor) {
+    uint32_t frequency = clock_get_frequency(0, source) / (divisor == 0 ? 1 : divisor);
+    common_hal_mcu_disable_interrupts();
+    // Divisors that a generator can't do exactly won't match because the frequency is compared
+    // rather than the divisor. Sources with an unknown frequency are never shared.
+    for (uint8_t i = 0; i < GCLK_GEN_NUM; i++) {
+        if (gclk_variable(i) || !gclk_enabled(i) || (gclk_users[i] == 0 && !gclk_fixed(i))) {
+            continue;
+        }
+        if (frequency != 0 && gclk_get_source(i) == source && gclk_get_frequency(i) == frequency) {
+            gclk_users[i]++;
+            common_hal_mcu_enable_interrupts();
+            return i;
+        }
+    }
+    uint8_t gclk = find_free_gclk(divisor);
+    if (gclk != 0xff) {
+        enable_clock_generator(gclk, source, divisor);
+        gclk_users[gclk] = 1;
+    }
+    common_hal_mcu_enable_interrupts();
+    return gclk;
+}
+
+void release_gclk(uint8_t gclk) {
+    common_hal_mcu_disable_interrupts();
+    if (gclk_users[gclk] > 0) {
+        gclk_users[gclk]--;
+        if (gclk_users[gclk] == 0 && !gclk_fixed(gclk)) {
+            disable_clock_generator(gclk);
+        }
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint8_t connect_shared_gclk_to_peripheral(uint8_t source, uint16_t divisor, uint8_t peripheral) {
+    uint8_t gclk = claim_gclk(source, divisor);
+    if (gclk != 0xff && !gclk_channel_claim(gclk, peripheral)) {
+        release_gclk(gclk);
+        return 0xff;
+    }
+    return gclk;
+}
+
+void disconnect_shared_gclk_from_peripheral(uint8_t gclk, uint8_t peripheral) {
+    gclk_channel_release(peripheral);
+    release_gclk(gclk);
+}
+
+uint8_t gclk_get_usage(gclk_usage_t usage[GCLK_GEN_NUM]) {
+    uint8_t running = 0;
+    for (uint8_t i = 0; i < GCLK_GEN_NUM; i++) {
+        gclk_usage_t* entry = &usage[i];
+        entry->enabled = gclk_enabled(i);
+        entry->users = gclk_users[i];
+        entry->fixed = gclk_fixed(i);
+        entry->source = gclk_get_source(i);
+        entry->frequency = gclk_get_frequency(i);
+        if (entry->enabled) {
+            running++;
+        }
+    }
+    return running;
+}
+
 void init_dynamic_clocks(void) {
     // Find the last statically initialized clock and save it. Everything after will be reset with
     // the VM via reset_gclks.
@@ -72,4 +190,7 @@ void reset_gclks(void) {
     for (uint8_t i = last_static_clock + 1; i < GCLK_GEN_NUM; i++) {
         disable_gclk(i);
     }
+    for (uint8_t i = 0; i < GCLK_GEN_NUM; i++) {
+        gclk_users[i] = 0;
+    }
 }
@@ -32,6 +32,10 @@
 
 #include "include/sam.h"
 
+#include "samd_peripherals_config.h"
+
+#include "samd/dpll.h"
+
 #ifdef SAM_D5X_E5X
 #define CLOCK_48MHZ GCLK_GENCTRL_SRC_DFLL_Val
 #endif
@@ -49,6 +53,32 @@ uint8_t find_free_gclk(uint16_t divisor);
 bool gclk_enabled(uint8_t gclk);
 void disable_gclk(uint8_t gclk);
 void reset_gclks(void);
+uint8_t gclk_get_source(uint8_t gclk);
+// Zero when the generator is off or its source's frequency isn't known.
+uint32_t gclk_get_frequency(uint8_t gclk);
+
+// Generators shared by everything that wants the same source at the same output frequency. Each
+// claim must be matched by a release and the generator is turned off after the last one. The core
+// clock and, on the SAM_D5X_E5X, anything else running from DPLL0 are never shared because they
+// change speed with the performance level. Statically set up generators are shared but never
+// turned off. Returns 0xff when no generator is free.
+uint8_t claim_gclk(uint8_t source, uint16_t divisor);
+void release_gclk(uint8_t gclk);
+// Claim a generator and the peripheral's channel in one go. Also returns 0xff when the channel is
+// claimed on a different generator.
+uint8_t connect_shared_gclk_to_peripheral(uint8_t source, uint16_t divisor, uint8_t peripheral);
+void disconnect_shared_gclk_from_peripheral(uint8_t gclk, uint8_t peripheral);
+
+typedef struct {
+    uint32_t frequency;
+    uint8_t source;
+    uint8_t users;      // Claims through claim_gclk().
+    bool enabled;
+    bool fixed;         // Set up statically or the core clock so never turned off by a release.
+} gclk_usage_t;
+
+// Fills one entry per generator and returns how many are running.
+uint8_t gclk_get_usage(gclk_usage_t usage[GCLK_GEN_NUM]);
 
 void connect_gclk_to_peripheral(uint8_t gclk, uint8_t peripheral);
 void disconnect_gclk_from_peripheral(uint8_t gclk, uint8_t peripheral);
@@ -57,8 +87,66 @@ void enable_clock_generator(uint8_t gclk, uint32_t source, uint16_t divisor);
 void disable_clock_generator(uint8_t gclk);
 
 void clock_init(bool has_crystal, uint32_t dfll48m_fine_calibration);
+#ifdef SAMD21
+// Queries on the SAMD21 answer from a copy of the clock tree that clock_init() fills in and the
+// functions above keep up to date. Generators and channels that the copy has as off are read back
+// from the registers, so turning one on elsewhere is noticed. Call this after turning one off,
+// moving a channel to another generator or changing a divisor any other way.
+void clock_tree_refresh(void);
+#endif
 void init_dynamic_clocks(void);
 
+// Drivers whose settings depend on a generator's frequency register here to hear about changes to
+// the clock tree. They're called with CLOCK_CHANGE_BEFORE so they can pause and again with
+// CLOCK_CHANGE_AFTER, once the new frequencies can be read with clock_get_frequency(), so they can
+// recompute baud rates, prescalers and so on.
+#ifndef CLOCK_CHANGE_NOTIFIERS
+#define CLOCK_CHANGE_NOTIFIERS 8
+#endif
+
+typedef enum {
+    CLOCK_CHANGE_BEFORE,
+    CLOCK_CHANGE_AFTER,
+} clock_change_t;
+
+bool clock_add_notifier(void (*callback)(void* context, clock_change_t change), void* context);
+void clock_remove_notifier(void (*callback)(void* context, clock_change_t change), void* context);
+void clock_notify(clock_change_t change);
+
+#ifdef SAM_D5X_E5X
+// The CPU runs from GCLK0 through MCLK's CPUDIV. At 12MHz and 48MHz GCLK0 comes straight from the
+// DFLL and DPLL0 is stopped since its 96MHz minimum would only waste power. The others run GCLK0
+// from DPLL0. GCLK4 follows GCLK0's source so its users see every change too. 200MHz is beyond the
+// datasheet's rating.
+typedef enum {
+    PERFORMANCE_LEVEL_12MHZ,
+    PERFORMANCE_LEVEL_48MHZ,
+    PERFORMANCE_LEVEL_120MHZ,
+    PERFORMANCE_LEVEL_200MHZ,
+} performance_level_t;
+
+// Returns false for an unknown level or one DPLL0 can't reach. Also returns false when DPLL0
+// doesn't lock within about 10ms, leaving the 48MHz level in place. SysTick is rescaled to keep its
+// period.
+bool clock_set_performance_level(performance_level_t level);
+performance_level_t clock_get_performance_level(void);
+
+// The library can't know what crystal is fitted so register it to make XOSC0 and XOSC1 usable as
+// references and to have clock_get_frequency() report them.
+void clock_set_xosc_frequency(uint8_t xosc, uint32_t frequency);
+
+// refclk is an OSCCTRL_DPLLCTRLB_REFCLK_*_Val. Picks the settings that land closest to target
+// within the datasheet's limits of a 32kHz to 3.2MHz reference and 96MHz to 200MHz output, and
+// returns false when there are none. Doesn't touch any registers.
+bool dpll_solve(uint8_t refclk, uint32_t reference_frequency, uint32_t target, dpll_config_t* config);
+uint32_t dpll_reference_frequency(uint8_t refclk, uint8_t gclk);
+// Only for DPLL1, for example to give I2S an exact multiple of an audio sample rate. gclk is the
+// reference generator when refclk is GCLK. config is filled in with what was programmed. Returns
+// false with the DPLL stopped when it doesn't lock within about 10ms.
+bool dpll_start(uint8_t index, uint8_t refclk, uint8_t gclk, uint32_t target, dpll_config_t* config);
+void dpll_stop(uint8_t index);
+#endif
+
 bool clock_get_enabled(uint8_t type, uint8_t index);
 bool clock_get_parent(uint8_t type, uint8_t index, uint8_t *p_type, uint8_t *p_index);
 uint32_t clock_get_frequency(uint8_t type, uint8_t index);
@@ -33,6 +33,8 @@
 
 #include "hal/utils/include/utils.h"
 
+#include "samd/bus_clocks.h"
+
 #include "shared-bindings/microcontroller/__init__.h"
 
 COMPILER_ALIGNED(16) static DmacDescriptor dma_descriptors[DMA_CHANNEL_COUNT];
@@ -40,6 +42,8 @@ COMPILER_ALIGNED(16) static DmacDescriptor dma_descriptors[DMA_CHANNEL_COUNT];
 // Don't use these directly. They are used by the DMA engine itself.
 COMPILER_ALIGNED(16) static DmacDescriptor write_back_descriptors[DMA_CHANNEL_COUNT];
 
+static bool dma_clocks_on;
+
 #ifdef SAMD21
 #define FIRST_SERCOM_RX_TRIGSRC 0x01
 #define FIRST_SERCOM_TX_TRIGSRC 0x02
@@ -50,15 +54,18 @@ COMPILER_ALIGNED(16) static DmacDescriptor write_back_descriptors[DMA_CHANNEL_CO
 #endif
 
 void init_shared_dma(void) {
-    // Turn on the clocks
-    #ifdef SAM_D5X_E5X
-    MCLK->AHBMASK.reg |= MCLK_AHBMASK_DMAC;
-    #endif
+    // Turn on the clocks. The DMA stays in use for as long as we run so they're never released.
+    if (!dma_clocks_on) {
+        #ifdef SAM_D5X_E5X
+        bus_clock_claim(BUS_AHB, MCLK_AHBMASK_DMAC);
+        #endif
 
-    #ifdef SAMD21
-    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
-    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
-    #endif
+        #ifdef SAMD21
+        bus_clock_claim(BUS_AHB, PM_AHBMASK_DMAC);
+        bus_clock_claim(BUS_APBB, PM_APBBMASK_DMAC);
+        #endif
+        dma_clocks_on = true;
+    }
 
     DMAC->CTRL.reg = DMAC_CTRL_SWRST;
 
@@ -61,6 +61,7 @@ void dma_resume_channel(uint8_t channel_number);
 bool dma_channel_free(uint8_t channel_number);
 bool dma_channel_enabled(uint8_t channel_number);
 uint8_t dma_transfer_status(uint8_t channel_number);
+void dma_clear_transfer_status(uint8_t channel_number, uint8_t flags);
 DmacDescriptor* dma_descriptor(uint8_t channel_number);
 DmacDescriptor* dma_write_back_descriptor(uint8_t channel_number);
 
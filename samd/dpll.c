@@ -0,0 +1,124 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "samd/dpll.h"
+
+typedef struct {
+    uint32_t bandwidth;
+    uint8_t filter;
+} dpll_filter_t;
+
+// The datasheet's loop filters from widest to narrowest, taking the one with a damping factor
+// closest to 0.75 where several share a bandwidth.
+static const dpll_filter_t dpll_filters[] = {
+    {185400, 0x5},
+    {131000, 0x4},
+    {92700, 0x0},
+    {65600, 0x3},
+    {46400, 0xf},
+    {32800, 0xb},
+    {23200, 0xa},
+    {16400, 0xe},
+};
+
+#define DPLL_FILTER_COUNT (sizeof(dpll_filters) / sizeof(dpll_filters[0]))
+
+// The widest bandwidth that stays below a tenth of the reference. References under 164kHz have
+// nothing that narrow so they get the narrowest filter there is.
+static uint8_t dpll_filter(uint32_t reference) {
+    uint32_t limit = reference / 10;
+    for (uint8_t i = 0; i < DPLL_FILTER_COUNT - 1; i++) {
+        if (dpll_filters[i].bandwidth < limit) {
+            return dpll_filters[i].filter;
+        }
+    }
+    return dpll_filters[DPLL_FILTER_COUNT - 1].filter;
+}
+
+// The reference is frequency / divisor and the output is reference * ratio / 32 so the ratio
+// combines LDR + 1 and LDRFRAC. Works from the undivided frequency so that references that don't
+// divide evenly stay exact. Returns the error in 1/32 Hz or UINT64_MAX when the reference or output
+// is out of range.
+static uint64_t dpll_solve_ratio(uint32_t frequency, uint32_t divisor, uint32_t target,
+                                 uint32_t* ratio) {
+    if (frequency < (uint64_t) DPLL_MIN_REFERENCE * divisor ||
+        frequency > (uint64_t) DPLL_MAX_REFERENCE * divisor) {
+        return UINT64_MAX;
+    }
+    uint64_t scaled_target = (uint64_t) target * 32 * divisor;
+    uint64_t n = (scaled_target + frequency / 2) / frequency;
+    if (n < 32 || n > (DPLL_MAX_LDR + 1) * 32 + 31) {
+        return UINT64_MAX;
+    }
+    uint64_t output = n * frequency;
+    if (output < (uint64_t) DPLL_MIN_OUTPUT * 32 * divisor ||
+        output > (uint64_t) DPLL_MAX_OUTPUT * 32 * divisor) {
+        return UINT64_MAX;
+    }
+    *ratio = n;
+    uint64_t error = output > scaled_target ? output - scaled_target : scaled_target - output;
+    return (error + divisor / 2) / divisor;
+}
+
+bool dpll_solve_reference(uint32_t reference_frequency, bool divided, uint32_t target,
+                          dpll_config_t* config) {
+    uint32_t best_ratio = 0;
+    uint32_t best_divisor = 1;
+    uint16_t best_div = 0;
+    uint64_t best_error = UINT64_MAX;
+    if (divided) {
+        // XOSC references are divided by 2 * (DIV + 1). Faster references track better so stop at
+        // the first exact one.
+        for (uint16_t div = 0; div <= DPLL_MAX_DIV && best_error != 0; div++) {
+            uint32_t divisor = 2 * (div + 1);
+            if (reference_frequency < (uint64_t) DPLL_MIN_REFERENCE * divisor) {
+                break;
+            }
+            uint32_t ratio;
+            uint64_t error = dpll_solve_ratio(reference_frequency, divisor, target, &ratio);
+            if (error < best_error) {
+                best_error = error;
+                best_ratio = ratio;
+                best_divisor = divisor;
+                best_div = div;
+            }
+        }
+    } else {
+        best_error = dpll_solve_ratio(reference_frequency, 1, target, &best_ratio);
+    }
+    if (best_error == UINT64_MAX) {
+        return false;
+    }
+    config->ldr = best_ratio / 32 - 1;
+    config->ldrfrac = best_ratio % 32;
+    config->div = best_div;
+    config->filter = dpll_filter(reference_frequency / best_divisor);
+    config->frequency = ((uint64_t) reference_frequency * best_ratio) / (32 * best_divisor);
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_DPLL_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_DPLL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Settings for the SAM_D5X_E5X FDPLL200M. Nothing here touches registers so it builds and is
+// tested on the host.
+
+// Datasheet limits for the FDPLL200M.
+#define DPLL_MIN_REFERENCE 32000
+#define DPLL_MAX_REFERENCE 3200000
+#define DPLL_MIN_OUTPUT 96000000
+#define DPLL_MAX_OUTPUT 200000000
+#define DPLL_MAX_LDR 8191
+#define DPLL_MAX_DIV 2047
+
+typedef struct {
+    uint16_t ldr;
+    uint8_t ldrfrac;
+    uint16_t div;       // Only used for XOSC references.
+    uint8_t filter;
+    uint32_t frequency; // What the DPLL will actually run at.
+} dpll_config_t;
+
+// Only XOSC references go through the 2 * (DIV + 1) divider. Picks the settings that land closest
+// to target within the limits above and returns false when there are none.
+bool dpll_solve_reference(uint32_t reference_frequency, bool divided, uint32_t target,
+                          dpll_config_t* config);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_DPLL_H
@@ -0,0 +1,115 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/edge_capture.h"
+
+#include <stddef.h>
+
+#include "samd/external_interrupts.h"
+#include "samd/timestamp.h"
+
+#include "sam.h"
+
+static void edge_capture_handler(void* context) {
+    edge_capture_input_t* input = context;
+    edge_capture_t* self = input->capture;
+    uint32_t ticks = timestamp_ticks32();
+    bool level = (PORT->Group[input->pin / 32].IN.reg & (1u << (input->pin % 32))) != 0;
+    uint16_t head = self->head;
+    uint16_t next = (head + 1) & self->mask;
+    if (next == self->tail) {
+        self->overflows++;
+        return;
+    }
+    edge_capture_event_t* event = &self->events[head];
+    event->ticks = ticks;
+    event->channel = input - self->inputs;
+    event->level = level;
+    // Publish the event only after it's written.
+    __DMB();
+    self->head = next;
+}
+
+bool edge_capture_init(edge_capture_t* self, edge_capture_event_t* events, uint16_t length) {
+    if (length < 2 || (length & (length - 1)) != 0 || !timestamp_enabled()) {
+        return false;
+    }
+    self->events = events;
+    self->mask = length - 1;
+    self->head = 0;
+    self->tail = 0;
+    self->overflows = 0;
+    for (uint8_t i = 0; i < EIC_EXTINT_NUM; i++) {
+        self->inputs[i].capture = self;
+        self->inputs[i].pin = 0;
+    }
+    return true;
+}
+
+bool edge_capture_add_channel(edge_capture_t* self, uint8_t eic_channel, uint8_t pin_number,
+                              uint32_t sense) {
+    if (eic_channel >= EIC_EXTINT_NUM || !eic_channel_free(eic_channel)) {
+        return false;
+    }
+    if (!eic_get_enable()) {
+        turn_on_external_interrupt_controller();
+    }
+    edge_capture_input_t* input = &self->inputs[eic_channel];
+    input->pin = pin_number;
+    set_eic_channel_data(eic_channel, (void*) self);
+    eic_set_callback(eic_channel, edge_capture_handler, input);
+    turn_on_eic_channel(eic_channel, sense);
+    return true;
+}
+
+void edge_capture_remove_channel(edge_capture_t* self, uint8_t eic_channel) {
+    if (eic_channel >= EIC_EXTINT_NUM) {
+        return;
+    }
+    configure_eic_channel(eic_channel, EIC_CONFIG_SENSE0_NONE_Val);
+    turn_off_eic_channel(eic_channel);
+    self->inputs[eic_channel].pin = 0;
+}
+
+bool edge_capture_read(edge_capture_t* self, edge_capture_event_t* event) {
+    uint16_t tail = self->tail;
+    if (tail == self->head) {
+        return false;
+    }
+    *event = self->events[tail];
+    // Finish copying the event before handing its slot back to the interrupt.
+    __DMB();
+    self->tail = (tail + 1) & self->mask;
+    return true;
+}
+
+uint16_t edge_capture_available(edge_capture_t* self) {
+    return (self->head - self->tail) & self->mask;
+}
+
+uint32_t edge_capture_overflows(edge_capture_t* self) {
+    return self->overflows;
+}
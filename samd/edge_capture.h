@@ -0,0 +1,76 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EDGE_CAPTURE_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EDGE_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+// One edge. ticks is the low 32 bits of timestamp_ticks() so differences between events are valid
+// across a wrap. level is the pin as sampled in the interrupt so very short pulses can read back
+// the level after the next edge.
+typedef struct {
+    uint32_t ticks;
+    uint8_t channel;
+    bool level;
+} edge_capture_event_t;
+
+struct _edge_capture_t;
+
+typedef struct {
+    struct _edge_capture_t* capture;
+    uint8_t pin;
+} edge_capture_input_t;
+
+// Records edges from any number of EIC channels into one ring so that the interrupt only takes a
+// timestamp and decoding happens in thread context. The interrupt is the only producer and the
+// thread reading with edge_capture_read() is the only consumer so neither side needs a lock.
+// Requires timestamp_init().
+typedef struct _edge_capture_t {
+    edge_capture_event_t* events;
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint32_t overflows;
+    edge_capture_input_t inputs[EIC_EXTINT_NUM];
+} edge_capture_t;
+
+// length must be a power of two. One entry is kept empty to tell a full ring from an empty one.
+bool edge_capture_init(edge_capture_t* self, edge_capture_event_t* events, uint16_t length);
+// sense is one of the EIC_CONFIG_SENSE0_*_Val settings, usually BOTH.
+bool edge_capture_add_channel(edge_capture_t* self, uint8_t eic_channel, uint8_t pin_number,
+                              uint32_t sense);
+void edge_capture_remove_channel(edge_capture_t* self, uint8_t eic_channel);
+
+bool edge_capture_read(edge_capture_t* self, edge_capture_event_t* event);
+uint16_t edge_capture_available(edge_capture_t* self);
+// Edges dropped because the ring was full.
+uint32_t edge_capture_overflows(edge_capture_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EDGE_CAPTURE_H
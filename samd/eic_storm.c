@@ -0,0 +1,118 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/eic_storm.h"
+
+#include <stddef.h>
+
+#include "samd/external_interrupts.h"
+#include "samd/timestamp.h"
+
+#include "sam.h"
+
+static void eic_storm_handler(void* context) {
+    eic_storm_guard_t* self = context;
+    uint32_t now = timestamp_ticks32();
+    if (now - self->window_start >= self->window) {
+        self->window_start = now;
+        self->count = 0;
+    }
+    self->count++;
+    if (self->count > self->threshold) {
+        eic_mask_channel(self->eic_channel);
+        self->masked = true;
+        self->storms++;
+        self->last_storm = timestamp_ticks();
+        timer_wheel_start(&self->reenable, self->holdoff, 0);
+        return;
+    }
+    if (self->callback != NULL) {
+        self->callback(self->context);
+    } else {
+        shared_eic_handler(self->eic_channel);
+    }
+}
+
+static void eic_storm_reenable(void* context) {
+    eic_storm_guard_t* self = context;
+    // The channel may have been turned off and handed to someone else while it was masked.
+    void (*callback)(void* context);
+    void* callback_context;
+    eic_get_callback(self->eic_channel, &callback, &callback_context);
+    self->masked = false;
+    if (callback != eic_storm_handler || callback_context != self) {
+        return;
+    }
+    self->window_start = timestamp_ticks32();
+    self->count = 0;
+    // This also drops the edge that's been pending since the channel was masked.
+    eic_unmask_channel(self->eic_channel);
+}
+
+void eic_storm_guard(eic_storm_guard_t* self, uint8_t eic_channel, uint16_t threshold,
+                     uint32_t window, uint32_t holdoff) {
+    timer_wheel_timer_init(&self->reenable, eic_storm_reenable, self);
+    eic_get_callback(eic_channel, &self->callback, &self->context);
+    self->window_start = timestamp_ticks32();
+    self->window = window;
+    self->holdoff = holdoff;
+    self->threshold = threshold;
+    self->count = 0;
+    self->eic_channel = eic_channel;
+    self->masked = false;
+    self->storms = 0;
+    self->last_storm = 0;
+    eic_set_callback(eic_channel, eic_storm_handler, self);
+}
+
+void eic_storm_unguard(eic_storm_guard_t* self) {
+    timer_wheel_cancel(&self->reenable);
+    bool was_masked = self->masked;
+    self->masked = false;
+    void (*callback)(void* context);
+    void* callback_context;
+    eic_get_callback(self->eic_channel, &callback, &callback_context);
+    // Nothing to undo once turn_off_eic_channel() has cleared the channel.
+    if (callback != eic_storm_handler || callback_context != self) {
+        return;
+    }
+    eic_set_callback(self->eic_channel, self->callback, self->context);
+    if (was_masked) {
+        eic_unmask_channel(self->eic_channel);
+    }
+}
+
+uint32_t eic_storm_count(eic_storm_guard_t* self) {
+    return self->storms;
+}
+
+uint64_t eic_storm_last(eic_storm_guard_t* self) {
+    return self->last_storm;
+}
+
+bool eic_storm_masked(eic_storm_guard_t* self) {
+    return self->masked;
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EIC_STORM_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EIC_STORM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "samd/timer_wheel.h"
+
+// Rate limits one EIC channel so that a noisy input can't starve everything else. More than
+// threshold interrupts within window ticks masks the channel with eic_mask_channel() and a timer
+// unmasks it holdoff ticks later. Edges while it's masked are lost. Ticks are timestamp ticks and
+// the timer wheel must be running.
+typedef struct {
+    timer_wheel_timer_t reenable;
+    void (*callback)(void* context);  // The handler being guarded.
+    void* context;
+    uint32_t window_start;
+    uint32_t window;
+    uint32_t holdoff;
+    uint16_t threshold;
+    uint16_t count;
+    uint8_t eic_channel;
+    volatile bool masked;
+    volatile uint32_t storms;
+    volatile uint64_t last_storm;  // timestamp_ticks() when the channel was last masked.
+} eic_storm_guard_t;
+
+// Wraps whatever handler the channel has, so register its callback first. Channels without one
+// keep going to shared_eic_handler().
+void eic_storm_guard(eic_storm_guard_t* self, uint8_t eic_channel, uint16_t threshold,
+                     uint32_t window, uint32_t holdoff);
+// Puts the guarded handler back and unmasks the channel if a storm had masked it.
+void eic_storm_unguard(eic_storm_guard_t* self);
+
+uint32_t eic_storm_count(eic_storm_guard_t* self);
+uint64_t eic_storm_last(eic_storm_guard_t* self);
+bool eic_storm_masked(eic_storm_guard_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EIC_STORM_H
@@ -0,0 +1,114 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/event_pipeline.h"
+
+#include <stddef.h>
+
+#include "samd/dma.h"
+#include "samd/events.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+static void release_channels(event_pipeline_t* self, uint8_t count) {
+    for (uint8_t r = 0; r < count; r++) {
+        release_event_channel(self->event_channels[r]);
+    }
+}
+
+event_pipeline_error_t event_pipeline_start(event_pipeline_t* self,
+                                            const event_pipeline_config_t* config) {
+    self->active = false;
+    event_pipeline_error_t error = event_pipeline_validate(config);
+    if (error != EVENT_PIPELINE_OK) {
+        return error;
+    }
+    for (uint8_t i = 0; i < config->dma_stage_count; i++) {
+        if (!dma_channel_free(config->dma_stages[i].channel)) {
+            return EVENT_PIPELINE_DMA_CHANNEL_BUSY;
+        }
+    }
+
+    for (uint8_t r = 0; r < config->route_count; r++) {
+        uint8_t channel;
+        if (config->routes[r].gclk == EVENT_PIPELINE_ASYNC) {
+            channel = claim_async_event_channel(self);
+        } else {
+            channel = claim_sync_event_channel(self);
+        }
+        if (channel >= EVSYS_CHANNELS) {
+            release_channels(self, r);
+            return EVENT_PIPELINE_NO_FREE_CHANNEL;
+        }
+        self->event_channels[r] = channel;
+    }
+    self->config = config;
+
+    for (uint8_t i = 0; i < config->dma_stage_count; i++) {
+        const event_dma_stage_t* stage = &config->dma_stages[i];
+        dma_configure(stage->channel, stage->trigger, stage->output_event);
+        *dma_descriptor(stage->channel) = *stage->descriptor;
+        dma_enable_channel(stage->channel);
+    }
+    for (uint8_t r = 0; r < config->route_count; r++) {
+        const event_route_t* route = &config->routes[r];
+        for (uint8_t u = 0; u < route->user_count; u++) {
+            connect_event_user_to_channel(route->users[u], self->event_channels[r]);
+        }
+    }
+    for (uint8_t r = 0; r < config->route_count; r++) {
+        const event_route_t* route = &config->routes[r];
+        if (route->gclk == EVENT_PIPELINE_ASYNC) {
+            init_async_event_channel(self->event_channels[r], route->generator);
+        } else {
+            if (!init_resync_event_channel(self->event_channels[r], route->gclk, route->generator)) {
+                // Take apart everything done so far.
+                self->active = true;
+                event_pipeline_stop(self);
+                return EVENT_PIPELINE_GCLK_BUSY;
+            }
+        }
+    }
+    self->active = true;
+    return EVENT_PIPELINE_OK;
+}
+
+void event_pipeline_stop(event_pipeline_t* self) {
+    if (!self->active) {
+        return;
+    }
+    const event_pipeline_config_t* config = self->config;
+    common_hal_mcu_disable_interrupts();
+    // Generators go first so nothing new enters the chain while it's being taken apart.
+    release_channels(self, config->route_count);
+    for (uint8_t i = 0; i < config->dma_stage_count; i++) {
+        uint8_t channel = config->dma_stages[i].channel;
+        dma_disable_channel(channel);
+        dma_descriptor(channel)->BTCTRL.bit.VALID = false;
+    }
+    common_hal_mcu_enable_interrupts();
+    self->active = false;
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EVENT_PIPELINE_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EVENT_PIPELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+#include "samd_peripherals_config.h"
+
+#ifndef EVENT_PIPELINE_MAX_ROUTES
+#define EVENT_PIPELINE_MAX_ROUTES 4
+#endif
+#ifndef EVENT_PIPELINE_MAX_USERS
+#define EVENT_PIPELINE_MAX_USERS 4
+#endif
+
+// Use as a route's gclk for an asynchronous path.
+#define EVENT_PIPELINE_ASYNC 0xff
+
+// One event channel from a generator to its users. Routes with a gclk are resynchronized to it.
+typedef struct {
+    uint8_t generator;
+    uint8_t user_count;
+    uint8_t users[EVENT_PIPELINE_MAX_USERS];
+    uint8_t gclk;
+} event_route_t;
+
+// A DMA channel started by the pipeline. descriptor is copied into the channel's first descriptor
+// and may link to others that the caller keeps alive. Set output_event when a route uses the
+// channel as its generator.
+typedef struct {
+    const DmacDescriptor* descriptor;
+    uint8_t channel;
+    uint8_t trigger;
+    bool output_event;
+} event_dma_stage_t;
+
+// A zero CPU chain such as EIC edge -> TC capture -> DMA -> buffer. The peripherals at either end
+// are set up by the caller. The pipeline owns the routing and DMA in between.
+typedef struct {
+    const event_route_t* routes;
+    const event_dma_stage_t* dma_stages;
+    uint8_t route_count;
+    uint8_t dma_stage_count;
+} event_pipeline_config_t;
+
+typedef enum {
+    EVENT_PIPELINE_OK,
+    EVENT_PIPELINE_TOO_MANY_ROUTES,
+    EVENT_PIPELINE_TOO_MANY_USERS,
+    EVENT_PIPELINE_BAD_GENERATOR,
+    EVENT_PIPELINE_BAD_USER,
+    EVENT_PIPELINE_USER_REUSED,
+    EVENT_PIPELINE_TOO_MANY_SYNC_ROUTES,
+    EVENT_PIPELINE_BAD_DMA_CHANNEL,
+    EVENT_PIPELINE_DMA_CHANNEL_REUSED,
+    EVENT_PIPELINE_MISSING_DMA_EVENT,
+    EVENT_PIPELINE_NO_FREE_CHANNEL,
+    EVENT_PIPELINE_DMA_CHANNEL_BUSY,
+    EVENT_PIPELINE_GCLK_BUSY
+} event_pipeline_error_t;
+
+typedef struct {
+    const event_pipeline_config_t* config;
+    uint8_t event_channels[EVENT_PIPELINE_MAX_ROUTES];
+    bool active;
+} event_pipeline_t;
+
+// Checks a description without touching any registers so it can run on the host too. It catches
+// routes the hardware can't do: unknown generators and users, a user on two channels, more
+// resynchronized routes than channels that support them and DMA generators that don't output
+// events.
+event_pipeline_error_t event_pipeline_validate(const event_pipeline_config_t* config);
+
+// Validates, claims every channel and then configures from the end of the chain backwards: DMA
+// channels first, then users and finally generators so no event reaches a half configured stage.
+// Nothing is left claimed on failure.
+event_pipeline_error_t event_pipeline_start(event_pipeline_t* self,
+                                            const event_pipeline_config_t* config);
+// Tears everything down with interrupts off so no stage sees the pipeline partially removed.
+void event_pipeline_stop(event_pipeline_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_EVENT_PIPELINE_H
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Kept apart from event_pipeline.c so it builds on the host without the rest of the library.
+
+#include "samd/event_pipeline.h"
+
+#include <stddef.h>
+
+#include "samd/dma.h"
+#include "samd/events.h"
+
+event_pipeline_error_t event_pipeline_validate(const event_pipeline_config_t* config) {
+    if (config->route_count > EVENT_PIPELINE_MAX_ROUTES) {
+        return EVENT_PIPELINE_TOO_MANY_ROUTES;
+    }
+    uint32_t dma_channels = 0;
+    uint32_t dma_event_channels = 0;
+    for (uint8_t i = 0; i < config->dma_stage_count; i++) {
+        const event_dma_stage_t* stage = &config->dma_stages[i];
+        if (stage->channel >= DMA_CHANNEL_COUNT || stage->descriptor == NULL) {
+            return EVENT_PIPELINE_BAD_DMA_CHANNEL;
+        }
+        if ((dma_channels & (1UL << stage->channel)) != 0) {
+            return EVENT_PIPELINE_DMA_CHANNEL_REUSED;
+        }
+        dma_channels |= 1UL << stage->channel;
+        if (stage->output_event) {
+            dma_event_channels |= 1UL << stage->channel;
+        }
+    }
+
+    uint8_t sync_routes = 0;
+    for (uint8_t r = 0; r < config->route_count; r++) {
+        const event_route_t* route = &config->routes[r];
+        if (route->user_count > EVENT_PIPELINE_MAX_USERS) {
+            return EVENT_PIPELINE_TOO_MANY_USERS;
+        }
+        // Generator zero means none.
+        if (route->generator == 0 || route->generator > EVSYS_GENERATORS) {
+            return EVENT_PIPELINE_BAD_GENERATOR;
+        }
+        if (route->generator >= EVSYS_ID_GEN_DMAC_CH_0 &&
+            route->generator < EVSYS_ID_GEN_DMAC_CH_0 + DMAC_EVOUT_NUM) {
+            uint8_t dma_channel = route->generator - EVSYS_ID_GEN_DMAC_CH_0;
+            if ((dma_event_channels & (1UL << dma_channel)) == 0) {
+                return EVENT_PIPELINE_MISSING_DMA_EVENT;
+            }
+        }
+        if (route->gclk != EVENT_PIPELINE_ASYNC) {
+            sync_routes++;
+        }
+        // A user listens to exactly one channel.
+        for (uint8_t u = 0; u < route->user_count; u++) {
+            uint8_t user = route->users[u];
+            if (user >= EVSYS_USERS) {
+                return EVENT_PIPELINE_BAD_USER;
+            }
+            for (uint8_t other_r = 0; other_r <= r; other_r++) {
+                const event_route_t* other = &config->routes[other_r];
+                uint8_t end = other_r == r ? u : other->user_count;
+                for (uint8_t other_u = 0; other_u < end; other_u++) {
+                    if (other->users[other_u] == user) {
+                        return EVENT_PIPELINE_USER_REUSED;
+                    }
+                }
+            }
+        }
+    }
+    if (sync_routes > EVSYS_SYNCH_NUM) {
+        return EVENT_PIPELINE_TOO_MANY_SYNC_ROUTES;
+    }
+    return EVENT_PIPELINE_OK;
+}
@@ -24,14 +24,220 @@
  * THE SOFTWARE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "samd/events.h"
 
+#include "samd/bus_clocks.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+#if EVSYS_CHANNELS > 32
+#error "Claimed event channels must fit in one 32-bit mask."
+#endif
+
+#define ALL_CHANNELS ((uint32_t) ((1ULL << EVSYS_CHANNELS) - 1))
+#define SYNC_CHANNELS ((uint32_t) ((1ULL << EVSYS_SYNCH_NUM) - 1))
+
+#ifdef SAMD21
+#define EVSYS_BUS BUS_APBC
+#define EVSYS_BUS_MASK PM_APBCMASK_EVSYS
+#else
+#define EVSYS_BUS BUS_APBB
+#define EVSYS_BUS_MASK MCLK_APBBMASK_EVSYS
+#endif
+
+typedef struct {
+    void (*callback)(void* context);
+    void* context;
+} event_callback_t;
+
+static event_callback_t channel_callbacks[EVSYS_CHANNELS];
+static volatile uint32_t channel_overflows[EVSYS_CHANNELS];
+static volatile uint32_t callback_channels;
+
+static uint32_t claimed_channels;
+static const void* channel_owners[EVSYS_CHANNELS];
+static uint8_t channel_user_count[EVSYS_CHANNELS];
+// The channel each user is routed to or EVSYS_CHANNELS when it isn't.
+static uint8_t user_channels[EVSYS_USERS];
+static bool user_channels_valid;
+// Channels with a claim on their generic clock channel.
+static uint32_t clocked_channels;
+
+static void init_user_channels(void) {
+    if (user_channels_valid) {
+        return;
+    }
+    for (uint8_t user = 0; user < EVSYS_USERS; user++) {
+        user_channels[user] = EVSYS_CHANNELS;
+    }
+    user_channels_valid = true;
+}
+
+// Call with interrupts off. Returns EVSYS_CHANNELS when none of candidates is free.
+static uint8_t claim_from(uint32_t candidates, bool highest, const void* owner) {
+    // Claimed channels share one claim on the bus clock. Take it before the search reads EVSYS.
+    bool first = claimed_channels == 0;
+    if (first) {
+        bus_clock_claim(EVSYS_BUS, EVSYS_BUS_MASK);
+    }
+    uint32_t free = candidates & ~claimed_channels;
+    while (free != 0) {
+        uint8_t channel;
+        if (highest) {
+            channel = 31 - __builtin_clz(free);
+        } else {
+            channel = __builtin_ctz(free);
+        }
+        free &= ~(1UL << channel);
+        // Someone configured this one without claiming it. Skip it without claiming it so that it
+        // can be handed out once they turn it off.
+        if (!event_channel_free(channel)) {
+            continue;
+        }
+        claimed_channels |= 1UL << channel;
+        channel_owners[channel] = owner;
+        channel_user_count[channel] = 0;
+        return channel;
+    }
+    if (first) {
+        bus_clock_release(EVSYS_BUS, EVSYS_BUS_MASK);
+    }
+    return EVSYS_CHANNELS;
+}
+
+// Asynchronous channels come from the top so that the channels that support synchronous paths
+// stay free for as long as possible.
+uint8_t claim_async_event_channel(const void* owner) {
+    common_hal_mcu_disable_interrupts();
+    uint8_t channel = claim_from(ALL_CHANNELS, true, owner);
+    common_hal_mcu_enable_interrupts();
+    return channel;
+}
+
+uint8_t claim_sync_event_channel(const void* owner) {
+    common_hal_mcu_disable_interrupts();
+    uint8_t channel = claim_from(SYNC_CHANNELS, false, owner);
+    common_hal_mcu_enable_interrupts();
+    return channel;
+}
+
+void release_event_channel(uint8_t channel) {
+    if (channel >= EVSYS_CHANNELS) {
+        return;
+    }
+    common_hal_mcu_disable_interrupts();
+    init_user_channels();
+    for (uint8_t user = 0; user < EVSYS_USERS && channel_user_count[channel] > 0; user++) {
+        if (user_channels[user] == channel) {
+            route_event_user(user, EVSYS_CHANNELS);
+            user_channels[user] = EVSYS_CHANNELS;
+            channel_user_count[channel]--;
+        }
+    }
+    disable_event_channel(channel);
+    event_channel_release_gclk(channel);
+    channel_owners[channel] = NULL;
+    if ((claimed_channels & (1UL << channel)) != 0) {
+        claimed_channels &= ~(1UL << channel);
+        if (claimed_channels == 0) {
+            bus_clock_release(EVSYS_BUS, EVSYS_BUS_MASK);
+        }
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+bool event_channel_claim_gclk(uint8_t channel, uint8_t gclk) {
+    if (channel >= EVSYS_CHANNELS) {
+        return false;
+    }
+    common_hal_mcu_disable_interrupts();
+    event_channel_release_gclk(channel);
+    bool claimed = gclk_channel_claim(gclk, EVSYS_GCLK_ID_0 + channel);
+    if (claimed) {
+        clocked_channels |= 1UL << channel;
+    }
+    common_hal_mcu_enable_interrupts();
+    return claimed;
+}
+
+void event_channel_release_gclk(uint8_t channel) {
+    if (channel >= EVSYS_CHANNELS) {
+        return;
+    }
+    common_hal_mcu_disable_interrupts();
+    if ((clocked_channels & (1UL << channel)) != 0) {
+        clocked_channels &= ~(1UL << channel);
+        gclk_channel_release(EVSYS_GCLK_ID_0 + channel);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+const void* event_channel_owner(uint8_t channel) {
+    return channel_owners[channel];
+}
+
+uint8_t event_channel_user_count(uint8_t channel) {
+    return channel_user_count[channel];
+}
+
+bool connect_event_user_to_channel(uint8_t user, uint8_t channel) {
+    if (user >= EVSYS_USERS || channel >= EVSYS_CHANNELS) {
+        return false;
+    }
+    common_hal_mcu_disable_interrupts();
+    init_user_channels();
+    uint8_t previous = user_channels[user];
+    if (previous < EVSYS_CHANNELS) {
+        channel_user_count[previous]--;
+    }
+    route_event_user(user, channel);
+    user_channels[user] = channel;
+    channel_user_count[channel]++;
+    common_hal_mcu_enable_interrupts();
+    return true;
+}
+
+void disable_event_user(uint8_t user) {
+    if (user >= EVSYS_USERS) {
+        return;
+    }
+    common_hal_mcu_disable_interrupts();
+    init_user_channels();
+    uint8_t previous = user_channels[user];
+    if (previous < EVSYS_CHANNELS) {
+        channel_user_count[previous]--;
+    }
+    route_event_user(user, EVSYS_CHANNELS);
+    user_channels[user] = EVSYS_CHANNELS;
+    common_hal_mcu_enable_interrupts();
+}
+
+void reset_event_claims(void) {
+    common_hal_mcu_disable_interrupts();
+    while (clocked_channels != 0) {
+        event_channel_release_gclk(__builtin_ctz(clocked_channels));
+    }
+    if (claimed_channels != 0) {
+        bus_clock_release(EVSYS_BUS, EVSYS_BUS_MASK);
+    }
+    claimed_channels = 0;
+    for (uint8_t channel = 0; channel < EVSYS_CHANNELS; channel++) {
+        channel_owners[channel] = NULL;
+        channel_user_count[channel] = 0;
+    }
+    user_channels_valid = false;
+    common_hal_mcu_enable_interrupts();
+}
+
+// These don't claim the channel they return so prefer claim_async_event_channel() and
+// claim_sync_event_channel().
 uint8_t find_async_event_channel(void) {
     int8_t channel;
-    for (channel = EVSYS_CHANNELS - 1; channel > 0; channel--) {
-        if (event_channel_free(channel)) {
+    for (channel = EVSYS_CHANNELS - 1; channel >= 0; channel--) {
+        if ((claimed_channels & (1UL << channel)) == 0 && event_channel_free(channel)) {
             break;
         }
     }
@@ -44,9 +250,50 @@ uint8_t find_async_event_channel(void) {
 uint8_t find_sync_event_channel(void) {
     uint8_t channel;
     for (channel = 0; channel < EVSYS_SYNCH_NUM; channel++) {
-        if (event_channel_free(channel)) {
+        if ((claimed_channels & (1UL << channel)) == 0 && event_channel_free(channel)) {
             break;
         }
     }
     return channel;
 }
+
+void event_channel_set_callback(uint8_t channel, void (*callback)(void* context), void* context) {
+    event_callback_t* entry = &channel_callbacks[channel];
+    // Keep the handler from seeing the new callback with the old context.
+    common_hal_mcu_disable_interrupts();
+    entry->callback = callback;
+    entry->context = context;
+    channel_overflows[channel] = 0;
+    if (callback != NULL) {
+        callback_channels |= 1UL << channel;
+        enable_event_channel_irq(channel);
+    } else {
+        callback_channels &= ~(1UL << channel);
+        disable_event_channel_irq(channel);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint32_t event_callback_channels(void) {
+    return callback_channels;
+}
+
+uint32_t event_channel_overflows(uint8_t channel) {
+    return channel_overflows[channel];
+}
+
+void event_dispatch(uint32_t detected, uint32_t overflowed) {
+    while (overflowed != 0) {
+        uint8_t channel = __builtin_ctz(overflowed);
+        overflowed &= overflowed - 1;
+        channel_overflows[channel]++;
+    }
+    while (detected != 0) {
+        uint8_t channel = __builtin_ctz(detected);
+        detected &= detected - 1;
+        event_callback_t* entry = &channel_callbacks[channel];
+        if (entry->callback != NULL) {
+            entry->callback(entry->context);
+        }
+    }
+}
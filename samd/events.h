@@ -32,23 +32,72 @@
 
 #include "include/sam.h"
 
+#include "samd_peripherals_config.h"
+
 
 #ifdef SAMD21
 #define EVSYS_SYNCH_NUM EVSYS_CHANNELS
 #endif
 
+// Claimed channels keep the event system's bus clock on by themselves. This is only for code that
+// uses the find_*() functions below. Its claim lasts until reset_event_system().
 void turn_on_event_system(void);
 void reset_event_system(void);
+
+// Claimed channels are never handed out again until they're released, even before they have a
+// generator. Both return EVSYS_CHANNELS when every channel is taken. owner is only a tag for
+// debugging and may be NULL. The bus clock goes off with the last release.
+uint8_t claim_async_event_channel(const void* owner);
+uint8_t claim_sync_event_channel(const void* owner);
+// Disconnects every user routed to the channel, turns it off and drops its generic clock.
+void release_event_channel(uint8_t channel);
+// Claims the channel's generic clock on gclk in place of any it had. Returns false when another
+// generator has it. release_event_channel() drops it.
+bool event_channel_claim_gclk(uint8_t channel, uint8_t gclk);
+void event_channel_release_gclk(uint8_t channel);
+const void* event_channel_owner(uint8_t channel);
+uint8_t event_channel_user_count(uint8_t channel);
+void reset_event_claims(void);
+
 uint8_t find_async_event_channel(void);
 uint8_t find_sync_event_channel(void);
 void disable_event_channel(uint8_t channel_number);
 void disable_event_user(uint8_t user_number);
-void connect_event_user_to_channel(uint8_t user, uint8_t channel);
+// Returns false without touching anything when user or channel doesn't exist.
+bool connect_event_user_to_channel(uint8_t user, uint8_t channel);
+// Writes the user's channel without the bookkeeping above. EVSYS_CHANNELS disconnects it.
+void route_event_user(uint8_t user, uint8_t channel);
 void init_async_event_channel(uint8_t channel, uint8_t generator);
-void init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator);
+// Resynchronized channels pass rising edges to users that need events in their own clock domain.
+// Returns false without touching the channel when its generic clock is on another generator.
+bool init_resync_event_channel(uint8_t channel, uint8_t gclk, uint8_t generator);
+// Pulse a channel that has no generator, for example to hit all of its users at once. Software
+// events need a synchronous capable channel and a generic clock for it. This returns once every
+// user has taken the event, or false right away when the generic clock is on another generator.
+bool trigger_software_event(uint8_t channel, uint8_t gclk);
+bool init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator);
 bool event_interrupt_active(uint8_t channel);
 bool event_interrupt_overflow(uint8_t channel);
 
 bool event_channel_free(uint8_t channel);
 
+// The EVSYS handler calls callback for every event detected on the channel. Set the channel up with
+// init_event_channel_interrupt() first. Pass NULL to go back to polling with
+// event_interrupt_active(). Events that arrive before the previous one was handled are counted as
+// overflows rather than lost silently.
+void event_channel_set_callback(uint8_t channel, void (*callback)(void* context), void* context);
+uint32_t event_channel_overflows(uint8_t channel);
+void enable_event_channel_irq(uint8_t channel);
+// Masks the channel's interrupt and turns its line off once no callback is left on it.
+void disable_event_channel_irq(uint8_t channel);
+// The handler masks the interrupt of a channel without a callback but leaves its flags alone so
+// that they can still be polled.
+uint32_t event_callback_channels(void);
+// Called by the EVSYS handler with a bit per channel.
+void event_dispatch(uint32_t detected, uint32_t overflowed);
+
+#ifndef EVSYS_HANDLER
+#define EVSYS_HANDLER 1
+#endif
+
 #endif  // MICROPY_INCLUDED_ATMEL_SAMD_EVENTS_H
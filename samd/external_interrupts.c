@@ -27,7 +27,11 @@
 #include "common-hal/pulseio/PulseIn.h"
 #include "common-hal/rotaryio/IncrementalEncoder.h"
 #include "shared-bindings/microcontroller/__init__.h"
+#include "shared-bindings/microcontroller/Pin.h"
+#include "samd/events.h"
 #include "samd/external_interrupts.h"
+#include "samd/irq_latency.h"
+#include "samd/sync.h"
 
 #include "sam.h"
 
@@ -35,25 +39,263 @@
 // Without this there would be multiple arrays even though they are disjoint because each channel
 // has one user.
 static void *channel_data[EIC_EXTINT_NUM];
+static uint32_t latency_critical_channels;
+// Channels whose events go through an EVSYS channel claimed by turn_on_eic_event_channel().
+static uint32_t event_routed_channels;
+static uint8_t event_channels[EIC_EXTINT_NUM];
+// Pins sampled to replay edges that land while the SAMD51 has the EIC disabled.
+static uint32_t replay_channels;
+static uint8_t replay_pins[EIC_EXTINT_NUM];
+static eic_blind_stats_t blind_stats;
+// Channels that are on but have their interrupt masked for now.
+static uint32_t masked_channels;
+
+typedef struct {
+    void (*callback)(void* context);
+    void* context;
+} eic_callback_t;
+
+static eic_callback_t channel_callbacks[EIC_EXTINT_NUM];
+
+void eic_set_callback(uint8_t eic_channel, void (*callback)(void* context), void* context) {
+    eic_callback_t* entry = &channel_callbacks[eic_channel];
+    // Keep the handler from seeing the new callback with the old context.
+    common_hal_mcu_disable_interrupts();
+    entry->callback = callback;
+    entry->context = context;
+    common_hal_mcu_enable_interrupts();
+}
+
+void eic_get_callback(uint8_t eic_channel, void (**callback)(void* context), void** context) {
+    eic_callback_t* entry = &channel_callbacks[eic_channel];
+    *callback = entry->callback;
+    *context = entry->context;
+}
+
+void eic_dispatch(uint8_t channel) {
+    eic_callback_t* entry = &channel_callbacks[channel];
+    if (entry->callback != NULL) {
+        entry->callback(entry->context);
+    } else {
+        shared_eic_handler(channel);
+    }
+}
 
 void external_interrupt_handler(uint8_t channel) {
-    shared_eic_handler(channel);
+    IRQ_LATENCY_ENTRY(entry_cycles);
+    IRQ_LATENCY_RECORD(IRQ_LATENCY_EIC, entry_cycles);
+    eic_dispatch(channel);
+    IRQ_LATENCY_EXIT(IRQ_LATENCY_EIC, entry_cycles);
     EIC->INTFLAG.reg = (1 << channel) << EIC_INTFLAG_EXTINT_Pos;
 }
 
-void configure_eic_channel(uint8_t eic_channel, uint32_t sense_setting) {
-    uint8_t config_index = eic_channel / 8;
-    uint8_t position = (eic_channel % 8) * 4;
+#ifdef SAM_D5X_E5X
+// Sense settings in CONFIG only take effect on channels that aren't being reconfigured so these
+// are the only ones that can have an edge replayed.
+static bool edge_sensed(uint8_t eic_channel, bool before, bool after) {
+    uint32_t sense = (EIC->CONFIG[eic_channel / 8].reg >> ((eic_channel % 8) * 4)) & 0x7;
+    switch (sense) {
+        case EIC_CONFIG_SENSE0_RISE_Val:
+            return !before && after;
+        case EIC_CONFIG_SENSE0_FALL_Val:
+            return before && !after;
+        case EIC_CONFIG_SENSE0_BOTH_Val:
+            return before != after;
+        default:
+            // Level sensing fires again by itself once the EIC is back on.
+            return false;
+    }
+}
+
+static uint32_t sample_replay_pins(uint32_t channels) {
+    uint32_t levels = 0;
+    while (channels != 0) {
+        uint8_t channel = __builtin_ctz(channels);
+        channels &= channels - 1;
+        uint8_t pin = replay_pins[channel];
+        if ((PORT->Group[pin / 32].IN.reg & (1u << (pin % 32))) != 0) {
+            levels |= 1 << channel;
+        }
+    }
+    return levels;
+}
+#endif
+
+typedef struct {
+    uint32_t replay;
+    uint32_t before;
+    uint32_t start;
+} blind_window_t;
+
+// Every write to the enable protected registers happens between these so that the SAMD51 disables
+// the EIC, which is the only way to unlock them, once per batch rather than once per register.
+// Channels in changed are being reconfigured and aren't replayed.
+static void open_blind_window(blind_window_t* window, uint32_t changed) {
+    common_hal_mcu_disable_interrupts();
     #ifdef SAM_D5X_E5X
+    // Only CPU interrupts can be replayed. Events that fall in the gap are lost.
+    window->replay = replay_channels & EIC->INTENSET.reg & ~changed;
+    window->before = sample_replay_pins(window->replay);
+    window->start = DWT->CYCCNT;
     eic_set_enable(false);
+    #else
+    (void) window;
+    (void) changed;
+    #endif
+}
+
+static void close_blind_window(blind_window_t* window) {
+    #ifdef SAM_D5X_E5X
+    eic_set_enable(true);
+    // The channels are only watching again once the enable has synchronized.
+    SYNC_WAIT(EIC->SYNCBUSY.bit.ENABLE != 0);
+    uint32_t blind = DWT->CYCCNT - window->start;
+    uint32_t before = window->before;
+    uint32_t after = sample_replay_pins(window->replay);
+    uint32_t toggled = window->replay & (before ^ after);
+    while (toggled != 0) {
+        uint8_t channel = __builtin_ctz(toggled);
+        toggled &= toggled - 1;
+        if (edge_sensed(channel, (before & (1 << channel)) != 0, (after & (1 << channel)) != 0)) {
+            // Each channel has its own line and its handler dispatches without checking INTFLAG.
+            NVIC_SetPendingIRQ(EIC_0_IRQn + channel);
+            blind_stats.replayed_edges++;
+        }
+    }
+    blind_stats.windows++;
+    blind_stats.total_cycles += blind;
+    if (blind > blind_stats.max_cycles) {
+        blind_stats.max_cycles = blind;
+    }
+    #else
+    (void) window;
     #endif
+    common_hal_mcu_enable_interrupts();
+}
+
+static void reconfigure_eic(const eic_channel_config_t* configs, uint8_t count,
+                            uint32_t evctrl_set, uint32_t evctrl_clear) {
+    uint32_t changed = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        changed |= 1 << configs[i].eic_channel;
+    }
+    blind_window_t window;
+    open_blind_window(&window, changed);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t config_index = configs[i].eic_channel / 8;
+        uint8_t position = (configs[i].eic_channel % 8) * 4;
+        uint32_t masked_value = EIC->CONFIG[config_index].reg & ~(0xf << position);
+        EIC->CONFIG[config_index].reg = masked_value | (configs[i].sense_setting << position);
+    }
+    if (evctrl_set != 0 || evctrl_clear != 0) {
+        EIC->EVCTRL.reg = (EIC->EVCTRL.reg & ~evctrl_clear) | evctrl_set;
+    }
+    close_blind_window(&window);
+}
+
+#ifdef SAM_D5X_E5X
+// The debouncer replaces the majority vote filter so FILTEN is cleared along with it.
+void eic_set_debounce(uint8_t eic_channel, bool enable) {
+    uint32_t mask = 1 << eic_channel;
+    uint8_t config_index = eic_channel / 8;
+    uint32_t filter = EIC_CONFIG_FILTEN0 << ((eic_channel % 8) * 4);
+    blind_window_t window;
+    open_blind_window(&window, mask);
+    if (enable) {
+        EIC->CONFIG[config_index].reg &= ~filter;
+        EIC->DEBOUNCEN.reg |= mask;
+    } else {
+        EIC->DEBOUNCEN.reg &= ~mask;
+    }
+    close_blind_window(&window);
+}
+
+void eic_set_debounce_prescaler(uint32_t dprescaler) {
+    blind_window_t window;
+    open_blind_window(&window, 0);
+    EIC->DPRESCALER.reg = dprescaler;
+    close_blind_window(&window);
+}
+#endif
+
+void eic_configure_channels(const eic_channel_config_t* configs, uint8_t count) {
+    reconfigure_eic(configs, count, 0, 0);
+}
+
+// CONFIG and EVCTRL are changed in one go so the SAMD51 only needs one enable protected window.
+static void configure_eic_event_output(uint8_t eic_channel, uint32_t sense_setting, bool enable) {
+    eic_channel_config_t config = {eic_channel, sense_setting};
+    uint32_t mask = (1 << eic_channel) << EIC_EVCTRL_EXTINTEO_Pos;
+    reconfigure_eic(&config, 1, enable ? mask : 0, enable ? 0 : mask);
+}
+
+void configure_eic_channel(uint8_t eic_channel, uint32_t sense_setting) {
+    eic_channel_config_t config = {eic_channel, sense_setting};
+    reconfigure_eic(&config, 1, 0, 0);
+}
+
+// Generate an event on the channel's detections. EVCTRL is enable protected on the SAMD51.
+void eic_set_event_output(uint8_t eic_channel, bool enable) {
+    uint32_t mask = (1 << eic_channel) << EIC_EVCTRL_EXTINTEO_Pos;
+    reconfigure_eic(NULL, 0, enable ? mask : 0, enable ? 0 : mask);
+}
+
+void eic_set_replay_pin(uint8_t eic_channel, uint8_t pin_number) {
     common_hal_mcu_disable_interrupts();
-    uint32_t masked_value = EIC->CONFIG[config_index].reg & ~(0xf << position);
-    EIC->CONFIG[config_index].reg = masked_value | (sense_setting << position);
+    if (pin_number < NO_PIN) {
+        replay_pins[eic_channel] = pin_number;
+        replay_channels |= 1 << eic_channel;
+    } else {
+        replay_channels &= ~(1 << eic_channel);
+    }
     common_hal_mcu_enable_interrupts();
+}
+
+void eic_blind_stats_reset(void) {
     #ifdef SAM_D5X_E5X
-    eic_set_enable(true);
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
     #endif
+    common_hal_mcu_disable_interrupts();
+    blind_stats.windows = 0;
+    blind_stats.max_cycles = 0;
+    blind_stats.total_cycles = 0;
+    blind_stats.replayed_edges = 0;
+    common_hal_mcu_enable_interrupts();
+}
+
+void eic_get_blind_stats(eic_blind_stats_t* stats) {
+    common_hal_mcu_disable_interrupts();
+    *stats = blind_stats;
+    common_hal_mcu_enable_interrupts();
+}
+
+uint8_t turn_on_eic_event_channel(uint8_t eic_channel, uint32_t sense_setting, uint8_t event_user,
+                                  const void* owner) {
+    if (event_user >= EVSYS_USERS) {
+        return EVSYS_CHANNELS;
+    }
+    uint8_t event_channel = claim_async_event_channel(owner);
+    if (event_channel >= EVSYS_CHANNELS) {
+        return EVSYS_CHANNELS;
+    }
+    if (!eic_get_enable()) {
+        turn_on_external_interrupt_controller();
+    }
+    event_channels[eic_channel] = event_channel;
+    event_routed_channels |= 1 << eic_channel;
+    configure_eic_event_output(eic_channel, sense_setting, true);
+    // Connect the user first so no event reaches it half configured.
+    connect_event_user_to_channel(event_user, event_channel);
+    init_async_event_channel(event_channel, EVSYS_ID_GEN_EIC_EXTINT_0 + eic_channel);
+    return event_channel;
+}
+
+uint8_t eic_event_channel(uint8_t eic_channel) {
+    if ((event_routed_channels & (1 << eic_channel)) == 0) {
+        return EVSYS_CHANNELS;
+    }
+    return event_channels[eic_channel];
 }
 
 void turn_on_eic_channel(uint8_t eic_channel, uint32_t sense_setting) {
@@ -67,25 +309,84 @@ void turn_on_eic_channel(uint8_t eic_channel, uint32_t sense_setting) {
 
 void turn_off_eic_channel(uint8_t eic_channel) {
     uint32_t mask = 1 << eic_channel;
+    if ((event_routed_channels & mask) != 0) {
+        event_routed_channels &= ~mask;
+        // A reset since turn_on_eic_event_channel() has already dropped the output and the claims.
+        if ((EIC->EVCTRL.reg & (mask << EIC_EVCTRL_EXTINTEO_Pos)) != 0) {
+            // Stop the users before the generator goes quiet.
+            release_event_channel(event_channels[eic_channel]);
+            configure_eic_event_output(eic_channel, EIC_CONFIG_SENSE0_NONE_Val, false);
+        }
+    }
     EIC->INTENCLR.reg = mask << EIC_INTENSET_EXTINT_Pos;
     #ifdef SAM_D5X_E5X
     NVIC_DisableIRQ(EIC_0_IRQn + eic_channel);
     NVIC_ClearPendingIRQ(EIC_0_IRQn + eic_channel);
     #endif
     channel_data[eic_channel] = NULL;
+    channel_callbacks[eic_channel].callback = NULL;
+    #ifdef SAM_D5X_E5X
+    if ((EIC->DEBOUNCEN.reg & mask) != 0) {
+        eic_set_debounce(eic_channel, false);
+    }
+    #endif
+    latency_critical_channels &= ~(1 << eic_channel);
+    replay_channels &= ~(1 << eic_channel);
+    masked_channels &= ~mask;
 
     #ifdef SAMD21
-    if (EIC->INTENSET.reg == 0) {
+    if (EIC->INTENSET.reg == 0 && masked_channels == 0) {
         NVIC_DisableIRQ(EIC_IRQn);
         NVIC_ClearPendingIRQ(EIC_IRQn);
     }
     #endif
     // Test if all channels are null and deinit everything if they are.
-    if (EIC->EVCTRL.reg == 0 && EIC->INTENSET.reg == 0) {
+    if (EIC->EVCTRL.reg == 0 && EIC->INTENSET.reg == 0 && masked_channels == 0) {
         turn_off_external_interrupt_controller();
     }
 }
 
+void eic_mask_channel(uint8_t eic_channel) {
+    uint32_t mask = 1 << eic_channel;
+    common_hal_mcu_disable_interrupts();
+    masked_channels |= mask;
+    EIC->INTENCLR.reg = mask << EIC_INTENCLR_EXTINT_Pos;
+    common_hal_mcu_enable_interrupts();
+}
+
+void eic_unmask_channel(uint8_t eic_channel) {
+    uint32_t mask = 1 << eic_channel;
+    common_hal_mcu_disable_interrupts();
+    if ((masked_channels & mask) != 0) {
+        masked_channels &= ~mask;
+        EIC->INTFLAG.reg = mask << EIC_INTFLAG_EXTINT_Pos;
+        EIC->INTENSET.reg = mask << EIC_INTENSET_EXTINT_Pos;
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint32_t eic_masked_channels(void) {
+    return masked_channels;
+}
+
+void eic_clear_masks(void) {
+    masked_channels = 0;
+}
+
+void eic_set_latency_critical(uint8_t eic_channel, bool critical) {
+    common_hal_mcu_disable_interrupts();
+    if (critical) {
+        latency_critical_channels |= 1 << eic_channel;
+    } else {
+        latency_critical_channels &= ~(1 << eic_channel);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+uint32_t eic_latency_critical_channels(void) {
+    return latency_critical_channels;
+}
+
 void* get_eic_channel_data(uint8_t eic_channel) {
     return channel_data[eic_channel];
 }
@@ -36,11 +36,73 @@ void turn_on_cpu_interrupt(uint8_t eic_channel);
 void turn_on_eic_channel(uint8_t eic_channel, uint32_t sense_setting);
 void configure_eic_channel(uint8_t eic_channel, uint32_t sense_setting);
 void turn_off_eic_channel(uint8_t eic_channel);
+void eic_set_event_output(uint8_t eic_channel, bool enable);
+
+// The SAMD51 can only change CONFIG and EVCTRL with the EIC disabled, which blinds every channel
+// for the duration. Change several channels together to pay for that only once.
+typedef struct {
+    uint8_t eic_channel;
+    uint32_t sense_setting;  // The whole CONFIG field so include EIC_CONFIG_FILTEN0 to filter.
+} eic_channel_config_t;
+
+void eic_configure_channels(const eic_channel_config_t* configs, uint8_t count);
+// Sample pin_number before and after each blind window and pend the channel's interrupt when it
+// changed in a way the channel senses. An even number of edges in the window still goes unseen.
+// NO_PIN stops it. Cleared by turn_off_eic_channel().
+void eic_set_replay_pin(uint8_t eic_channel, uint8_t pin_number);
+
+typedef struct {
+    uint32_t windows;         // Times the EIC was disabled to reconfigure it.
+    uint32_t max_cycles;      // CPU cycles of the longest window.
+    uint64_t total_cycles;
+    uint32_t replayed_edges;
+} eic_blind_stats_t;
+
+// Cycles are counted with the DWT cycle counter, which eic_blind_stats_reset() starts. The SAMD21
+// has no blind window so its statistics stay zero.
+void eic_blind_stats_reset(void);
+void eic_get_blind_stats(eic_blind_stats_t* stats);
+
+#ifdef SAM_D5X_E5X
+// Hardware debouncing as a stronger alternative to EIC_CONFIG_FILTEN0. The channel must sense an
+// edge. dprescaler is the whole DPRESCALER register, which sets the sample rate and the number of
+// samples for channels 0-7 and 8-15 separately. Cleared by turn_off_eic_channel().
+void eic_set_debounce(uint8_t eic_channel, bool enable);
+void eic_set_debounce_prescaler(uint32_t dprescaler);
+#endif
+// Send the channel's edges to event_user through a newly claimed EVSYS channel instead of the CPU.
+// Returns the event channel, or EVSYS_CHANNELS when none are free or event_user doesn't exist.
+// turn_off_eic_channel() releases it again.
+uint8_t turn_on_eic_event_channel(uint8_t eic_channel, uint32_t sense_setting, uint8_t event_user,
+                                  const void* owner);
+// The event channel that turn_on_eic_event_channel() claimed, so more users can be connected to it.
+uint8_t eic_event_channel(uint8_t eic_channel);
 bool eic_channel_free(uint8_t eic_channel);
 bool eic_get_enable(void);
 void eic_set_enable(bool value);
 void eic_reset(void);
 
+// On the SAMD21, where all channels share one interrupt, latency critical channels are handled
+// before the rest when several are pending. Cleared by turn_off_eic_channel().
+void eic_set_latency_critical(uint8_t eic_channel, bool critical);
+uint32_t eic_latency_critical_channels(void);
+
+// Masks a channel's interrupt without giving the channel up, so the EIC stays on and the channel
+// isn't free. Unmasking drops the edge that's been pending since. Cleared by turn_off_eic_channel()
+// and eic_reset().
+void eic_mask_channel(uint8_t eic_channel);
+void eic_unmask_channel(uint8_t eic_channel);
+uint32_t eic_masked_channels(void);
+void eic_clear_masks(void);
+
+// Route a channel's interrupt directly to callback. Channels without one go to
+// shared_eic_handler(). Cleared by turn_off_eic_channel().
+void eic_set_callback(uint8_t eic_channel, void (*callback)(void* context), void* context);
+void eic_get_callback(uint8_t eic_channel, void (**callback)(void* context), void** context);
+void eic_dispatch(uint8_t channel);
+// NVIC priority of the channel's interrupt. Lower numbers preempt higher ones.
+void eic_set_channel_priority(uint8_t eic_channel, uint8_t priority);
+
 void* get_eic_channel_data(uint8_t eic_channel);
 void set_eic_channel_data(uint8_t eic_channel, void* data);
 
@@ -0,0 +1,200 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/frequency_counter.h"
+
+#include "samd/clocks.h"
+#include "samd/events.h"
+#include "samd/external_interrupts.h"
+#include "samd/timers.h"
+
+#include "sam.h"
+
+static uint32_t read_count(frequency_counter_t* self) {
+    Tc* tc = tc_insts[self->counter_index];
+    if (self->count_mask == 0xffff) {
+        return tc_read_count16(tc);
+    }
+    return tc_read_count32(tc);
+}
+
+static void release_tc_clocks(uint8_t tc_index, bool wide) {
+    timer_release_clocks(true, tc_index);
+    if (wide) {
+        timer_release_clocks(true, tc_index + 1);
+    }
+}
+
+static void frequency_counter_timer_handler(void* context) {
+    frequency_counter_t* self = context;
+    Tc* gate = tc_insts[self->gate_index];
+    if (gate->COUNT16.INTFLAG.bit.OVF == 0) {
+        return;
+    }
+    gate->COUNT16.INTFLAG.reg = TC_INTFLAG_OVF;
+    // Interrupt latency shifts both ends of a window equally so it doesn't accumulate.
+    uint32_t count = read_count(self);
+    self->edges = (count - self->last_count) & self->count_mask;
+    self->last_count = count;
+    self->ready = true;
+}
+
+static void start_gate(frequency_counter_t* self, const timer_period_t* window) {
+    Tc* gate = tc_insts[self->gate_index];
+    // Start the gate last so that the first window starts with a known count.
+    self->last_count = read_count(self);
+    tc_reset(gate);
+    tc_configure_period(gate, window);
+    gate->COUNT16.INTFLAG.reg = TC_INTFLAG_OVF;
+    gate->COUNT16.INTENSET.reg = TC_INTENSET_OVF;
+    tc_set_enable(gate, true);
+}
+
+// The counter counts events so only the gate depends on its clock's speed.
+static void frequency_counter_clock_changed(void* context, clock_change_t change) {
+    frequency_counter_t* self = context;
+    if (change == CLOCK_CHANGE_BEFORE) {
+        tc_set_enable(tc_insts[self->gate_index], false);
+        return;
+    }
+    self->ready = false;
+    timer_period_t window;
+    // Stay within the TCs that the gate already holds. Leave it off when that's not enough.
+    if (!timer_solve_period(true, self->gate_index, self->window_request, 1, 1,
+                            self->wide_gate ? 32 : 16, &window)) {
+        self->window_frequency = 0;
+        return;
+    }
+    self->window_frequency = window.frequency;
+    start_gate(self, &window);
+}
+
+bool frequency_counter_start(frequency_counter_t* self, uint8_t eic_channel, uint8_t counter_index,
+                             uint8_t gate_index, uint8_t gclk, uint32_t window_frequency, bool wide) {
+    Tc* counter = tc_insts[counter_index];
+    Tc* gate = tc_insts[gate_index];
+    if (!eic_channel_free(eic_channel) || counter_index == gate_index ||
+        counter->COUNT16.CTRLA.bit.ENABLE == 1 || gate->COUNT16.CTRLA.bit.ENABLE == 1) {
+        return false;
+    }
+    if (wide && ((counter_index + TC_OFFSET) % 2 != 0 || counter_index + 1 >= TC_INST_NUM ||
+                 counter_index + 1 == gate_index)) {
+        return false;
+    }
+
+    // The gate only needs an overflow so stay in one TC unless the window needs a COUNT32 pair.
+    if (!timer_claim_clocks(true, gate_index, gclk)) {
+        return false;
+    }
+    timer_period_t window;
+    if ((!timer_solve_period(true, gate_index, window_frequency, 1, 1, 16, &window) &&
+         !timer_solve_period(true, gate_index, window_frequency, 1, 1, 0, &window)) ||
+        (window.counter_bits == 32 && (gate_index + 1 >= TC_INST_NUM || gate_index + 1 == counter_index))) {
+        timer_release_clocks(true, gate_index);
+        return false;
+    }
+    bool wide_gate = window.counter_bits == 32;
+    if (wide_gate && !timer_claim_clocks(true, gate_index + 1, gclk)) {
+        timer_release_clocks(true, gate_index);
+        return false;
+    }
+    if (!timer_claim_clocks(true, counter_index, gclk)) {
+        release_tc_clocks(gate_index, wide_gate);
+        return false;
+    }
+    if (wide && !timer_claim_clocks(true, counter_index + 1, gclk)) {
+        timer_release_clocks(true, counter_index);
+        release_tc_clocks(gate_index, wide_gate);
+        return false;
+    }
+
+    // The counter ignores the edges until it's enabled below.
+    uint8_t event_channel = turn_on_eic_event_channel(eic_channel, EIC_CONFIG_SENSE0_RISE_Val,
+                                                      tc_event_user_ids[counter_index], self);
+    if (event_channel >= EVSYS_CHANNELS) {
+        release_tc_clocks(counter_index, wide);
+        release_tc_clocks(gate_index, wide_gate);
+        return false;
+    }
+    set_eic_channel_data(eic_channel, (void*) self);
+
+    self->counter_index = counter_index;
+    self->gate_index = gate_index;
+    self->wide_gate = wide_gate;
+    self->eic_channel = eic_channel;
+    self->event_channel = event_channel;
+    self->window_frequency = window.frequency;
+    self->window_request = window_frequency;
+    self->edges = 0;
+    self->ready = false;
+
+    tc_reset(counter);
+    if (wide) {
+        counter->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_PRESCALER_DIV1;
+        self->count_mask = 0xffffffff;
+    } else {
+        counter->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1;
+        self->count_mask = 0xffff;
+    }
+    counter->COUNT16.EVCTRL.reg = TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_COUNT;
+    tc_wait_for_sync(counter);
+    tc_enable_continuous_read(counter);
+    tc_set_enable(counter, true);
+
+    timer_set_callback(true, gate_index, frequency_counter_timer_handler, self);
+    tc_enable_interrupts(gate_index);
+    start_gate(self, &window);
+
+    if (!clock_add_notifier(frequency_counter_clock_changed, self)) {
+        frequency_counter_stop(self);
+        return false;
+    }
+    return true;
+}
+
+void frequency_counter_stop(frequency_counter_t* self) {
+    clock_remove_notifier(frequency_counter_clock_changed, self);
+    Tc* gate = tc_insts[self->gate_index];
+    tc_disable_interrupts(self->gate_index);
+    timer_set_callback(true, self->gate_index, NULL, NULL);
+    tc_set_enable(gate, false);
+    tc_reset(gate);
+    release_tc_clocks(self->gate_index, self->wide_gate);
+
+    turn_off_eic_channel(self->eic_channel);
+
+    Tc* counter = tc_insts[self->counter_index];
+    tc_set_enable(counter, false);
+    tc_reset(counter);
+    release_tc_clocks(self->counter_index, self->count_mask == 0xffffffff);
+}
+
+uint32_t frequency_counter_get(frequency_counter_t* self) {
+    if (!self->ready) {
+        return 0;
+    }
+    return self->edges * self->window_frequency;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_FREQUENCY_COUNTER_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_FREQUENCY_COUNTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Counts the edges on a pin without interrupting the CPU for each one. The pin's EIC channel
+// drives a TC's count event input through the event system. A second TC overflows once per
+// measurement window and its interrupt reads the count, so the CPU only wakes once per window.
+typedef struct {
+    uint32_t last_count;
+    uint32_t count_mask;
+    volatile uint32_t edges;   // Rising edges in the last complete window.
+    uint32_t window_frequency; // Windows per second as achieved by the gate timer.
+    uint32_t window_request;   // As asked for, to solve again when the gate's clock changes.
+    uint8_t counter_index;
+    uint8_t gate_index;
+    uint8_t eic_channel;
+    uint8_t event_channel;
+    bool wide_gate;            // The gate is COUNT32 and also holds the TC after gate_index.
+    volatile bool ready;
+} frequency_counter_t;
+
+// The counter's clock must run at more than twice the highest input frequency. A wide counter
+// uses COUNT32 so counter_index must be an even-numbered TC. Otherwise the input must stay under
+// 65536 edges per window. The gate is solved again when its clock changes speed.
+bool frequency_counter_start(frequency_counter_t* self, uint8_t eic_channel, uint8_t counter_index,
+                             uint8_t gate_index, uint8_t gclk, uint32_t window_frequency, bool wide);
+void frequency_counter_stop(frequency_counter_t* self);
+
+// Returns the frequency in Hz measured over the last complete window.
+uint32_t frequency_counter_get(frequency_counter_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_FREQUENCY_COUNTER_H
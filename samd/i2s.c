@@ -27,6 +27,7 @@
 #include "i2s.h"
 
 #include "clocks.h"
+#include "sync.h"
 
 #include "hpl/gclk/hpl_gclk_base.h"
 #ifdef SAMD21
@@ -34,13 +35,13 @@
 #endif
 
 void i2s_set_enable(bool enable) {
-    while (I2S->SYNCBUSY.bit.ENABLE == 1) {}
+    SYNC_WAIT(I2S->SYNCBUSY.bit.ENABLE == 1);
     I2S->CTRLA.bit.ENABLE = enable;
-    while (I2S->SYNCBUSY.bit.ENABLE == 1) {}
+    SYNC_WAIT(I2S->SYNCBUSY.bit.ENABLE == 1);
 }
 
 void i2s_set_clock_unit_enable(uint8_t clock_unit, bool enable) {
-    while ((I2S->SYNCBUSY.vec.CKEN & (1 << clock_unit)) != 0) {}
+    SYNC_WAIT((I2S->SYNCBUSY.vec.CKEN & (1 << clock_unit)) != 0);
     I2S->CTRLA.vec.CKEN = 1 << clock_unit;
-    while ((I2S->SYNCBUSY.vec.CKEN & (1 << clock_unit)) != 0) {}
+    SYNC_WAIT((I2S->SYNCBUSY.vec.CKEN & (1 << clock_unit)) != 0);
 }
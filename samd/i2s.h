@@ -32,7 +32,9 @@
 
 #include "include/sam.h"
 
+// Repeated calls share one claim on the I2S clocks. Turn it off once the I2S is disabled.
 void turn_on_i2s(void);
+void turn_off_i2s(void);
 
 void i2s_set_enable(bool enable);
 void i2s_set_clock_unit_enable(uint8_t clock, bool enable);
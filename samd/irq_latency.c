@@ -0,0 +1,99 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/irq_latency.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+#include "sam.h"
+
+#if IRQ_LATENCY_STATS
+static irq_latency_stats_t irq_latency[IRQ_LATENCY_SOURCES];
+
+static uint32_t cycles_since(uint32_t entry) {
+    uint32_t now = sync_cycle_count();
+    #ifdef SAMD21
+    // SysTick wrapped since the entry.
+    if (now < entry) {
+        now += SysTick->LOAD + 1;
+    }
+    #endif
+    return now - entry;
+}
+
+void irq_latency_record(irq_latency_source_t source, uint32_t entry) {
+    uint32_t elapsed = cycles_since(entry);
+    // Higher priority handlers can record in the middle of this.
+    common_hal_mcu_disable_interrupts();
+    irq_latency_stats_t* stats = &irq_latency[source];
+    stats->dispatches++;
+    stats->total_cycles += elapsed;
+    if (elapsed > stats->max_cycles) {
+        stats->max_cycles = elapsed;
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+void irq_latency_record_handler(irq_latency_source_t source, uint32_t entry) {
+    uint32_t elapsed = cycles_since(entry);
+    common_hal_mcu_disable_interrupts();
+    if (elapsed > irq_latency[source].max_handler_cycles) {
+        irq_latency[source].max_handler_cycles = elapsed;
+    }
+    common_hal_mcu_enable_interrupts();
+}
+#endif
+
+void irq_latency_reset(void) {
+    #if IRQ_LATENCY_STATS
+    #ifdef SAM_D5X_E5X
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+    common_hal_mcu_disable_interrupts();
+    for (uint8_t source = 0; source < IRQ_LATENCY_SOURCES; source++) {
+        irq_latency[source].dispatches = 0;
+        irq_latency[source].max_cycles = 0;
+        irq_latency[source].total_cycles = 0;
+        irq_latency[source].max_handler_cycles = 0;
+    }
+    common_hal_mcu_enable_interrupts();
+    #endif
+}
+
+void irq_latency_get_stats(irq_latency_source_t source, irq_latency_stats_t* stats) {
+    #if IRQ_LATENCY_STATS
+    common_hal_mcu_disable_interrupts();
+    *stats = irq_latency[source];
+    common_hal_mcu_enable_interrupts();
+    #else
+    (void) source;
+    stats->dispatches = 0;
+    stats->max_cycles = 0;
+    stats->total_cycles = 0;
+    stats->max_handler_cycles = 0;
+    #endif
+}
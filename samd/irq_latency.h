@@ -0,0 +1,79 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_IRQ_LATENCY_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_IRQ_LATENCY_H
+
+#include <stdint.h>
+
+#include "samd/sync.h"
+
+#include "samd_peripherals_config.h"
+
+// How long interrupt handlers take to reach their callbacks: the table lookup and, where handlers
+// share a line, the callbacks that ran first. Also how long the callbacks keep the handler busy,
+// which is what other interrupts at the same priority wait for. Counted from the handler's entry,
+// so the hardware's own entry latency isn't included. Cycles come from sync_cycle_count() with the
+// same caveats.
+
+#ifndef IRQ_LATENCY_STATS
+#define IRQ_LATENCY_STATS 0
+#endif
+
+typedef enum {
+    IRQ_LATENCY_TIMER,
+    IRQ_LATENCY_EIC,
+    // SAMD21 channels marked with eic_set_latency_critical(), which go ahead of the rest.
+    IRQ_LATENCY_EIC_CRITICAL,
+    IRQ_LATENCY_SOURCES
+} irq_latency_source_t;
+
+typedef struct {
+    uint32_t dispatches;
+    uint32_t max_cycles;          // From the handler's entry to a callback.
+    uint64_t total_cycles;
+    uint32_t max_handler_cycles;  // From the handler's entry to its return.
+} irq_latency_stats_t;
+
+#if IRQ_LATENCY_STATS
+void irq_latency_record(irq_latency_source_t source, uint32_t entry);
+void irq_latency_record_handler(irq_latency_source_t source, uint32_t entry);
+
+// Take the entry time first thing in the handler, record it right before each callback and once
+// more when the handler is done.
+#define IRQ_LATENCY_ENTRY(name) uint32_t name = sync_cycle_count()
+#define IRQ_LATENCY_RECORD(source, name) irq_latency_record(source, name)
+#define IRQ_LATENCY_EXIT(source, name) irq_latency_record_handler(source, name)
+#else
+#define IRQ_LATENCY_ENTRY(name)
+#define IRQ_LATENCY_RECORD(source, name) ((void) 0)
+#define IRQ_LATENCY_EXIT(source, name) ((void) 0)
+#endif
+
+void irq_latency_reset(void);
+void irq_latency_get_stats(irq_latency_source_t source, irq_latency_stats_t* stats);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_IRQ_LATENCY_H
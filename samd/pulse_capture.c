@@ -0,0 +1,152 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/pulse_capture.h"
+
+#include "samd/dma.h"
+#include "samd/events.h"
+#include "samd/external_interrupts.h"
+#include "samd/timers.h"
+
+#include "sam.h"
+
+// Copy a compare register into a circular buffer, one halfword per trigger.
+static void init_capture_descriptor(DmacDescriptor* descriptor, volatile uint16_t* source,
+                                    uint16_t* buffer, uint16_t length) {
+    descriptor->BTCTRL.reg = DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_DSTINC;
+    descriptor->BTCNT.reg = length;
+    descriptor->SRCADDR.reg = (uint32_t) source;
+    descriptor->DSTADDR.reg = (uint32_t) (buffer + length);
+    descriptor->DESCADDR.reg = (uint32_t) descriptor;
+    descriptor->BTCTRL.bit.VALID = true;
+}
+
+bool pulse_capture_start(pulse_capture_t* self, uint8_t eic_channel, uint8_t tc_index,
+                         uint8_t gclk, uint8_t prescaler_index, bool measure_low,
+                         uint8_t width_dma_channel, uint8_t period_dma_channel,
+                         uint16_t* widths, uint16_t* periods, uint16_t length) {
+    Tc* tc = tc_insts[tc_index];
+    if (length == 0 || !eic_channel_free(eic_channel) || tc->COUNT16.CTRLA.bit.ENABLE == 1 ||
+        width_dma_channel >= DMA_CHANNEL_COUNT || !dma_channel_free(width_dma_channel) ||
+        period_dma_channel >= DMA_CHANNEL_COUNT || !dma_channel_free(period_dma_channel)) {
+        return false;
+    }
+    // The TC needs the pin level rather than edges so the channel senses high. The TC ignores
+    // events until it's enabled below.
+    uint8_t event_channel = turn_on_eic_event_channel(eic_channel, EIC_CONFIG_SENSE0_HIGH_Val,
+                                                      tc_event_user_ids[tc_index], self);
+    if (event_channel >= EVSYS_CHANNELS) {
+        return false;
+    }
+    set_eic_channel_data(eic_channel, (void*) self);
+
+    self->widths = widths;
+    self->periods = periods;
+    self->length = length;
+    self->read_index = 0;
+    self->tc_index = tc_index;
+    self->eic_channel = eic_channel;
+    self->event_channel = event_channel;
+    self->width_dma_channel = width_dma_channel;
+    self->period_dma_channel = period_dma_channel;
+
+    if (!timer_claim_clocks(true, tc_index, gclk)) {
+        turn_off_eic_channel(eic_channel);
+        return false;
+    }
+    tc_reset(tc);
+    // PPW puts the period in CC0 and the width in CC1. Inverting the event measures low pulses.
+    tc_configure_capture(tc, prescaler_index, TC_EVCTRL_EVACT_PPW_Val, measure_low);
+
+    // Reading a capture clears its DMA request. The period channel starts with a single beat into
+    // first_period without incrementing, which is how write_index() tells it apart.
+    dma_configure(period_dma_channel, tc_ovf_dmac_ids[tc_index] + 1, false);
+    init_capture_descriptor(&self->period_descriptor, &tc->COUNT16.CC[0].reg, periods, length);
+    DmacDescriptor* discard = dma_descriptor(period_dma_channel);
+    discard->BTCTRL.reg = DMAC_BTCTRL_BEATSIZE_HWORD;
+    discard->BTCNT.reg = 1;
+    discard->SRCADDR.reg = (uint32_t) &tc->COUNT16.CC[0].reg;
+    discard->DSTADDR.reg = (uint32_t) &self->first_period;
+    discard->DESCADDR.reg = (uint32_t) &self->period_descriptor;
+    discard->BTCTRL.bit.VALID = true;
+    // Forget whatever the channel's last user left in its write back descriptor.
+    dma_write_back_descriptor(period_dma_channel)->BTCTRL.reg = 0;
+    dma_enable_channel(period_dma_channel);
+
+    dma_configure(width_dma_channel, tc_ovf_dmac_ids[tc_index] + 2, false);
+    init_capture_descriptor(dma_descriptor(width_dma_channel), &tc->COUNT16.CC[1].reg, widths,
+                            length);
+    dma_enable_channel(width_dma_channel);
+    tc_set_enable(tc, true);
+    return true;
+}
+
+void pulse_capture_stop(pulse_capture_t* self) {
+    turn_off_eic_channel(self->eic_channel);
+
+    Tc* tc = tc_insts[self->tc_index];
+    tc_set_enable(tc, false);
+    tc_reset(tc);
+    timer_release_clocks(true, self->tc_index);
+    dma_disable_channel(self->width_dma_channel);
+    dma_disable_channel(self->period_dma_channel);
+    self->period_descriptor.BTCTRL.bit.VALID = false;
+}
+
+// The write back descriptor's count tells us how far into the buffer the DMA has written. A pulse's
+// period is captured when the next one starts so it's complete once its period has been copied.
+static uint16_t write_index(pulse_capture_t* self) {
+    DmacDescriptor* write_back = dma_write_back_descriptor(self->period_dma_channel);
+    if (write_back->BTCTRL.bit.DSTINC == 0) {
+        return 0;
+    }
+    uint16_t remaining = write_back->BTCNT.reg;
+    if (remaining == 0 || remaining > self->length) {
+        return 0;
+    }
+    return self->length - remaining;
+}
+
+uint16_t pulse_capture_available(pulse_capture_t* self) {
+    uint16_t write = write_index(self);
+    if (write >= self->read_index) {
+        return write - self->read_index;
+    }
+    return self->length - self->read_index + write;
+}
+
+bool pulse_capture_read(pulse_capture_t* self, uint16_t* width, uint16_t* period) {
+    if (pulse_capture_available(self) == 0) {
+        return false;
+    }
+    *width = self->widths[self->read_index];
+    *period = self->periods[self->read_index];
+    self->read_index++;
+    if (self->read_index == self->length) {
+        self->read_index = 0;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PULSE_CAPTURE_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PULSE_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+#include "hal/utils/include/utils.h"
+
+// Measures pulses entirely in hardware. The pin's EIC channel drives a TC through the event
+// system. The TC captures the period into CC0 at the start of every pulse and the pulse width into
+// CC1 at its end, and two DMA channels copy them into circular buffers. The first period capture
+// only covers the time since start so it's dropped, which pairs each width with the period that
+// its pulse starts. Widths and periods are in TC ticks.
+typedef struct {
+    // The period channel's own descriptor drops the first capture and then links to this one.
+    COMPILER_ALIGNED(16) DmacDescriptor period_descriptor;
+    uint16_t first_period;
+    uint16_t* widths;
+    uint16_t* periods;
+    uint16_t length;
+    uint16_t read_index;
+    uint8_t tc_index;
+    uint8_t eic_channel;
+    uint8_t event_channel;
+    uint8_t width_dma_channel;
+    uint8_t period_dma_channel;
+} pulse_capture_t;
+
+// Measures high pulses unless measure_low is set. The buffers must each hold length entries.
+bool pulse_capture_start(pulse_capture_t* self, uint8_t eic_channel, uint8_t tc_index,
+                         uint8_t gclk, uint8_t prescaler_index, bool measure_low,
+                         uint8_t width_dma_channel, uint8_t period_dma_channel,
+                         uint16_t* widths, uint16_t* periods, uint16_t length);
+void pulse_capture_stop(pulse_capture_t* self);
+
+uint16_t pulse_capture_available(pulse_capture_t* self);
+bool pulse_capture_read(pulse_capture_t* self, uint16_t* width, uint16_t* period);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PULSE_CAPTURE_H
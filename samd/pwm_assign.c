@@ -0,0 +1,101 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/pwm_assign.h"
+
+typedef struct {
+    const pwm_assign_request_t* requests;
+    pwm_assign_timer_t* timers;
+    uint8_t count;
+    uint8_t order[PWM_CHANNELS_MAX_REQUESTS];
+    uint8_t slots[PWM_CHANNELS_MAX_REQUESTS];
+    uint8_t* best_slots;
+    uint8_t best_cost;
+} assign_search_t;
+
+static void assign_search(assign_search_t* search, uint8_t depth, uint8_t cost) {
+    if (cost >= search->best_cost) {
+        return;
+    }
+    if (depth == search->count) {
+        search->best_cost = cost;
+        for (uint8_t i = 0; i < search->count; i++) {
+            search->best_slots[i] = search->slots[i];
+        }
+        return;
+    }
+    uint8_t r = search->order[depth];
+    const pwm_assign_request_t* request = &search->requests[r];
+    // Try sharing a running timer before starting a new one so the first complete assignment is
+    // already a good bound.
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t i = 0; i < request->option_count; i++) {
+            const pwm_assign_option_t* option = &request->options[i];
+            pwm_assign_timer_t* timer = &search->timers[option->timer];
+            bool running = timer->frequency != 0;
+            if (timer->taken || running != (pass == 0) ||
+                (running && timer->frequency != request->frequency) ||
+                (timer->channels & (1 << option->channel)) != 0) {
+                continue;
+            }
+            timer->frequency = request->frequency;
+            timer->channels |= 1 << option->channel;
+            search->slots[r] = option->slot;
+            assign_search(search, depth + 1, cost + (running ? 0 : 1));
+            timer->channels &= ~(1 << option->channel);
+            if (!running) {
+                timer->frequency = 0;
+            }
+        }
+    }
+}
+
+bool pwm_assign(const pwm_assign_request_t* requests, uint8_t count, pwm_assign_timer_t* timers,
+                uint8_t* slots) {
+    if (count > PWM_CHANNELS_MAX_REQUESTS) {
+        return false;
+    }
+    assign_search_t search;
+    search.requests = requests;
+    search.timers = timers;
+    search.count = count;
+    search.best_slots = slots;
+    search.best_cost = 0xff;
+    for (uint8_t r = 0; r < count; r++) {
+        if (requests[r].option_count == 0 || requests[r].frequency == 0) {
+            return false;
+        }
+        // Insertion sort by the number of options.
+        uint8_t i = r;
+        while (i > 0 && requests[search.order[i - 1]].option_count > requests[r].option_count) {
+            search.order[i] = search.order[i - 1];
+            i--;
+        }
+        search.order[i] = r;
+    }
+    assign_search(&search, 0, 0);
+    return search.best_cost != 0xff;
+}
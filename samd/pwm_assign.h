@@ -0,0 +1,72 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PWM_ASSIGN_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PWM_ASSIGN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The timer search behind pwm_channels_assign(). Nothing here touches registers so it builds and
+// is tested on the host.
+
+// The most requests searched at once.
+#ifndef PWM_CHANNELS_MAX_REQUESTS
+#define PWM_CHANNELS_MAX_REQUESTS 16
+#endif
+
+// The most timers a single pin can reach.
+#define PWM_ASSIGN_MAX_OPTIONS 3
+
+// A timer output that a request could use.
+typedef struct {
+    uint8_t timer;    // Index into the timers passed to pwm_assign().
+    uint8_t channel;  // Compare channel.
+    uint8_t slot;     // What pwm_assign() hands back when this option is picked.
+} pwm_assign_option_t;
+
+typedef struct {
+    uint32_t frequency;
+    uint8_t option_count;
+    pwm_assign_option_t options[PWM_ASSIGN_MAX_OPTIONS];
+} pwm_assign_request_t;
+
+typedef struct {
+    uint32_t frequency;  // Zero when the timer isn't running PWM.
+    uint8_t channels;    // Compare channels in use.
+    bool taken;          // Running something else.
+} pwm_assign_timer_t;
+
+// Picks an option for each request so that the requests, together with the outputs that are
+// already running, use as few timers as possible. Outputs at the same frequency share a timer, each
+// on its own compare channel. Requests with the fewest options are placed first and the search
+// abandons any partial assignment that already uses as many new timers as the best one found.
+// timers is scratch during the search and comes back unchanged. Returns false when there is no
+// assignment. slots gets the slot of the picked option for each request.
+bool pwm_assign(const pwm_assign_request_t* requests, uint8_t count, pwm_assign_timer_t* timers,
+                uint8_t* slots);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PWM_ASSIGN_H
@@ -0,0 +1,376 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/pwm_channels.h"
+
+#include <stddef.h>
+
+#include "samd/clocks.h"
+#include "samd/sync.h"
+#include "samd/timers.h"
+
+#include "sam.h"
+
+#define TIMER_COUNT (TCC_INST_NUM + TC_INST_NUM)
+
+#if NUM_TIMERS_PER_PIN > PWM_ASSIGN_MAX_OPTIONS
+#error "Every timer of a pin must fit in a pwm_assign_request_t."
+#endif
+
+typedef struct {
+    uint32_t frequency;        // As requested. Zero when we aren't using the timer.
+    uint32_t actual_frequency;
+    uint32_t top;
+    uint8_t refcount;
+    uint8_t channels;          // Compare channels in use.
+    uint8_t counter_bits;
+    uint8_t prescaler_index;
+    uint16_t duty[8];          // Per compare channel so a new period can keep the duty cycles.
+} pwm_timer_t;
+
+// TCCs first and then TCs.
+static pwm_timer_t pwm_timers[TIMER_COUNT];
+static bool clock_notifier_added;
+
+static uint8_t timer_key(const pin_timer_t* t) {
+    if (t->is_tc) {
+        return TCC_INST_NUM + t->index;
+    }
+    return t->index;
+}
+
+// Returns the compare channel the output uses or 0xff when it can't do variable frequency PWM. TCs
+// use CC0 as the period so only their second output works.
+static uint8_t output_channel(const pin_timer_t* t) {
+    if (t->is_tc) {
+        if (t->index >= TC_INST_NUM || t->wave_output != 1) {
+            return 0xff;
+        }
+        return 1;
+    }
+    if (t->index >= TCC_INST_NUM) {
+        return 0xff;
+    }
+    return t->wave_output % tcc_cc_num[t->index];
+}
+
+// Whether something other than us is running the timer.
+static bool timer_taken(const pin_timer_t* t) {
+    if (pwm_timers[timer_key(t)].refcount > 0) {
+        return false;
+    }
+    if (t->is_tc) {
+        return tc_insts[t->index]->COUNT16.CTRLA.bit.ENABLE == 1;
+    }
+    return tcc_insts[t->index]->CTRLA.bit.ENABLE == 1;
+}
+
+bool pwm_channels_assign(const pwm_request_t* requests, uint8_t count, uint8_t* timer_slots) {
+    if (count > PWM_CHANNELS_MAX_REQUESTS) {
+        return false;
+    }
+    pwm_assign_request_t options[PWM_CHANNELS_MAX_REQUESTS];
+    pwm_assign_timer_t timers[TIMER_COUNT];
+    for (uint8_t i = 0; i < TIMER_COUNT; i++) {
+        timers[i].frequency = pwm_timers[i].frequency;
+        timers[i].channels = pwm_timers[i].channels;
+        timers[i].taken = false;
+    }
+    for (uint8_t r = 0; r < count; r++) {
+        pwm_assign_request_t* request = &options[r];
+        request->frequency = requests[r].frequency;
+        request->option_count = 0;
+        for (uint8_t slot = 0; slot < NUM_TIMERS_PER_PIN; slot++) {
+            const pin_timer_t* t = &requests[r].pin->timer[slot];
+            uint8_t cc = output_channel(t);
+            if (cc == 0xff) {
+                continue;
+            }
+            uint8_t key = timer_key(t);
+            timers[key].taken = timer_taken(t);
+            request->options[request->option_count++] = (pwm_assign_option_t) {
+                .timer = key,
+                .channel = cc,
+                .slot = slot,
+            };
+        }
+    }
+    return pwm_assign(options, count, timers, timer_slots);
+}
+
+static void set_compare(const pin_timer_t* t, uint8_t cc, uint32_t value) {
+    if (t->is_tc) {
+        Tc* tc = tc_insts[t->index];
+        if (pwm_timers[timer_key(t)].counter_bits == 8) {
+            #ifdef SAMD21
+            tc->COUNT8.CC[cc].reg = value;
+            #endif
+            #ifdef SAM_D5X_E5X
+            tc->COUNT8.CCBUF[cc].reg = value;
+            #endif
+        } else {
+            // The SAMD21's TCs have no buffer so a write can stretch or clip the current period.
+            #ifdef SAMD21
+            tc->COUNT16.CC[cc].reg = value;
+            #endif
+            #ifdef SAM_D5X_E5X
+            tc->COUNT16.CCBUF[cc].reg = value;
+            #endif
+        }
+    } else {
+        Tcc* tcc = tcc_insts[t->index];
+        #ifdef SAMD21
+        tcc->CCB[cc].reg = value;
+        #endif
+        #ifdef SAM_D5X_E5X
+        tcc->CCBUF[cc].reg = value;
+        #endif
+    }
+}
+
+static void set_top(const pin_timer_t* t, uint32_t top) {
+    if (t->is_tc) {
+        Tc* tc = tc_insts[t->index];
+        if (pwm_timers[timer_key(t)].counter_bits == 8) {
+            #ifdef SAMD21
+            tc->COUNT8.PER.reg = top;
+            #endif
+            #ifdef SAM_D5X_E5X
+            tc->COUNT8.PERBUF.reg = top;
+            #endif
+        } else {
+            set_compare(t, 0, top);
+        }
+    } else {
+        Tcc* tcc = tcc_insts[t->index];
+        #ifdef SAMD21
+        tcc->PERB.reg = top;
+        #endif
+        #ifdef SAM_D5X_E5X
+        tcc->PERBUF.reg = top;
+        #endif
+    }
+}
+
+static void configure_timer(const pin_timer_t* t, const timer_period_t* period) {
+    uint32_t prescaler_setting = TC_CTRLA_PRESCALER(period->prescaler_index);
+    if (t->is_tc) {
+        Tc* tc = tc_insts[t->index];
+        tc_reset(tc);
+        if (period->counter_bits == 8) {
+            #ifdef SAMD21
+            tc->COUNT8.CTRLA.reg = TC_CTRLA_MODE_COUNT8 | TC_CTRLA_WAVEGEN_NPWM | prescaler_setting;
+            #endif
+            #ifdef SAM_D5X_E5X
+            tc->COUNT8.CTRLA.reg = TC_CTRLA_MODE_COUNT8 | prescaler_setting;
+            tc->COUNT8.WAVE.reg = TC_WAVE_WAVEGEN_NPWM;
+            #endif
+            tc->COUNT8.PER.reg = period->top;
+        } else {
+            #ifdef SAMD21
+            tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MPWM | prescaler_setting;
+            #endif
+            #ifdef SAM_D5X_E5X
+            tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | prescaler_setting;
+            tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MPWM;
+            #endif
+            tc->COUNT16.CC[0].reg = period->top;
+        }
+        tc_wait_for_sync(tc);
+        tc_set_enable(tc, true);
+    } else {
+        Tcc* tcc = tcc_insts[t->index];
+        tcc_set_enable(tcc, false);
+        tcc_reset(tcc);
+        tcc->CTRLA.reg = TCC_CTRLA_PRESCALER(period->prescaler_index);
+        tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+        tcc->PER.reg = period->top;
+        SYNC_WAIT(tcc->SYNCBUSY.reg != 0);
+        tcc_set_enable(tcc, true);
+    }
+}
+
+// Duty is a 16-bit fraction so ask for that many steps per period and only settle for fewer when
+// the frequency can't be reached otherwise.
+static bool solve_pwm_period(const pin_timer_t* t, uint32_t frequency, uint8_t max_counter_bits,
+                             timer_period_t* period) {
+    for (uint32_t resolution = 1UL << 16; resolution > 0; resolution >>= 1) {
+        if (timer_solve_period(t->is_tc, t->index, frequency, resolution, 1, max_counter_bits, period)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t duty_to_compare(const pwm_timer_t* timer, uint16_t duty) {
+    // Full duty has to pass top so the output never goes low, unless top is already the counter's
+    // maximum.
+    if (duty == 0xffff) {
+        uint32_t max = (uint32_t) ((1ULL << timer->counter_bits) - 1);
+        return timer->top < max ? timer->top + 1 : max;
+    }
+    return ((uint64_t) (timer->top + 1) * duty) / 0xffff;
+}
+
+// Running timers are solved again for their requested frequency when their clock changes speed.
+static void pwm_clock_changed(void* context, clock_change_t change) {
+    (void) context;
+    if (change != CLOCK_CHANGE_AFTER) {
+        return;
+    }
+    for (uint8_t key = 0; key < TIMER_COUNT; key++) {
+        pwm_timer_t* timer = &pwm_timers[key];
+        if (timer->refcount == 0) {
+            continue;
+        }
+        pin_timer_t t = {
+            .index = key < TCC_INST_NUM ? key : key - TCC_INST_NUM,
+            .is_tc = key >= TCC_INST_NUM,
+        };
+        timer_period_t period;
+        // Leave the timer as it is if it can't reach the frequency anymore.
+        if (!solve_pwm_period(&t, timer->frequency, t.is_tc ? 16 : 0, &period)) {
+            continue;
+        }
+        timer->actual_frequency = period.frequency;
+        timer->top = period.top;
+        timer->counter_bits = period.counter_bits;
+        timer->prescaler_index = period.prescaler_index;
+        configure_timer(&t, &period);
+        for (uint8_t cc = 0; cc < 8; cc++) {
+            if ((timer->channels & (1 << cc)) != 0) {
+                set_compare(&t, cc, duty_to_compare(timer, timer->duty[cc]));
+            }
+        }
+    }
+}
+
+bool pwm_channel_start(pwm_channel_t* self, const mcu_pin_obj_t* pin, uint8_t timer_slot,
+                       uint32_t frequency, uint8_t gclk) {
+    if (timer_slot >= NUM_TIMERS_PER_PIN || frequency == 0) {
+        return false;
+    }
+    if (!clock_notifier_added) {
+        clock_notifier_added = clock_add_notifier(pwm_clock_changed, NULL);
+        if (!clock_notifier_added) {
+            return false;
+        }
+    }
+    const pin_timer_t* t = &pin->timer[timer_slot];
+    uint8_t cc = output_channel(t);
+    if (cc == 0xff || timer_taken(t)) {
+        return false;
+    }
+    pwm_timer_t* timer = &pwm_timers[timer_key(t)];
+    if (timer->refcount > 0 && (timer->frequency != frequency || (timer->channels & (1 << cc)) != 0)) {
+        return false;
+    }
+    if (timer->refcount == 0) {
+        if (!timer_claim_clocks(t->is_tc, t->index, gclk)) {
+            return false;
+        }
+        timer_period_t period;
+        // Wider TCs need a second TC so stick to a single one.
+        if (!solve_pwm_period(t, frequency, t->is_tc ? 16 : 0, &period)) {
+            timer_release_clocks(t->is_tc, t->index);
+            return false;
+        }
+        timer->frequency = frequency;
+        timer->actual_frequency = period.frequency;
+        timer->top = period.top;
+        timer->counter_bits = period.counter_bits;
+        timer->prescaler_index = period.prescaler_index;
+        configure_timer(t, &period);
+    }
+    timer->refcount++;
+    timer->channels |= 1 << cc;
+    self->pin = pin;
+    self->timer_slot = timer_slot;
+    self->cc = cc;
+    self->duty = 0;
+    timer->duty[cc] = 0;
+    set_compare(t, cc, 0);
+    return true;
+}
+
+void pwm_channel_stop(pwm_channel_t* self) {
+    if (self->pin == NULL) {
+        return;
+    }
+    const pin_timer_t* t = &self->pin->timer[self->timer_slot];
+    pwm_timer_t* timer = &pwm_timers[timer_key(t)];
+    set_compare(t, self->cc, 0);
+    timer->channels &= ~(1 << self->cc);
+    timer->refcount--;
+    if (timer->refcount == 0) {
+        timer->frequency = 0;
+        if (t->is_tc) {
+            Tc* tc = tc_insts[t->index];
+            tc_set_enable(tc, false);
+            tc_reset(tc);
+        } else {
+            tcc_set_enable(tcc_insts[t->index], false);
+        }
+        timer_release_clocks(t->is_tc, t->index);
+    }
+    self->pin = NULL;
+}
+
+void pwm_channel_set_duty(pwm_channel_t* self, uint16_t duty) {
+    const pin_timer_t* t = &self->pin->timer[self->timer_slot];
+    self->duty = duty;
+    pwm_timers[timer_key(t)].duty[self->cc] = duty;
+    set_compare(t, self->cc, duty_to_compare(&pwm_timers[timer_key(t)], duty));
+}
+
+bool pwm_channel_set_frequency(pwm_channel_t* self, uint32_t frequency) {
+    const pin_timer_t* t = &self->pin->timer[self->timer_slot];
+    pwm_timer_t* timer = &pwm_timers[timer_key(t)];
+    if (timer->frequency == frequency) {
+        return true;
+    }
+    if (timer->refcount != 1) {
+        return false;
+    }
+    timer_period_t period;
+    if (!solve_pwm_period(t, frequency, timer->counter_bits, &period) ||
+        period.counter_bits != timer->counter_bits ||
+        period.prescaler_index != timer->prescaler_index) {
+        return false;
+    }
+    timer->frequency = frequency;
+    timer->actual_frequency = period.frequency;
+    timer->top = period.top;
+    set_top(t, period.top);
+    // Keep the same duty fraction across the new period.
+    set_compare(t, self->cc, duty_to_compare(timer, self->duty));
+    return true;
+}
+
+uint32_t pwm_channel_get_frequency(pwm_channel_t* self) {
+    const pin_timer_t* t = &self->pin->timer[self->timer_slot];
+    return pwm_timers[timer_key(t)].actual_frequency;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PWM_CHANNELS_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PWM_CHANNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "samd/pins.h"
+#include "samd/pwm_assign.h"
+
+typedef struct {
+    const mcu_pin_obj_t* pin;
+    uint32_t frequency;
+} pwm_request_t;
+
+// One PWM output. Outputs at the same requested frequency share a timer, each on its own compare
+// channel. The pin needs to be muxed to MUX_E + timer_slot by the caller.
+typedef struct {
+    const mcu_pin_obj_t* pin;
+    uint16_t duty;
+    uint8_t timer_slot;
+    uint8_t cc;
+} pwm_channel_t;
+
+// Picks an entry of each pin's timer list so that the requests, together with the outputs that
+// are already running, use as few timers as possible. Timers running something else are skipped.
+// See pwm_assign() for the search. Returns false when there is no assignment. timer_slots gets one
+// index into pin->timer per request. At most PWM_CHANNELS_MAX_REQUESTS requests are searched.
+bool pwm_channels_assign(const pwm_request_t* requests, uint8_t count, uint8_t* timer_slots);
+
+// Starts the output on pin->timer[timer_slot]. The timer is set up from gclk when this is its first
+// output. Later outputs must ask for the same frequency.
+bool pwm_channel_start(pwm_channel_t* self, const mcu_pin_obj_t* pin, uint8_t timer_slot,
+                       uint32_t frequency, uint8_t gclk);
+void pwm_channel_stop(pwm_channel_t* self);
+
+// duty is a fraction of 0xffff. The new value takes effect at the next period boundary where the
+// hardware has buffered compare registers so an output never sees a partial period.
+void pwm_channel_set_duty(pwm_channel_t* self, uint16_t duty);
+
+// Timers are set up again for their requested frequency when clock_set_performance_level() changes
+// their clock. Outputs keep their duty cycles but may glitch once.
+
+// Only works when this is the timer's only output and the new frequency fits without changing the
+// prescaler. The period and duty are then swapped at a period boundary too.
+bool pwm_channel_set_frequency(pwm_channel_t* self, uint32_t frequency);
+uint32_t pwm_channel_get_frequency(pwm_channel_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_PWM_CHANNELS_H
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/quadrature.h"
+
+#include "samd/external_interrupts.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+#include "sam.h"
+
+// Steps indexed by the previous and new levels of A and B, (A << 3) | (B << 2) | (A << 1) | B.
+// Unchanged levels and impossible double steps don't move.
+static const int8_t quadrature_steps[16] = {
+    0, -1, 1, 0,
+    1, 0, 0, -1,
+    -1, 0, 0, 1,
+    0, 1, -1, 0,
+};
+
+static uint8_t read_levels(quadrature_t* self) {
+    uint8_t a = (PORT->Group[self->pin_a / 32].IN.reg & (1u << (self->pin_a % 32))) != 0;
+    uint8_t b = (PORT->Group[self->pin_b / 32].IN.reg & (1u << (self->pin_b % 32))) != 0;
+    return (a << 1) | b;
+}
+
+// Both channels land here so whichever edge comes second still sees the first one's level.
+static void quadrature_eic_handler(void* context) {
+    quadrature_t* self = context;
+    uint8_t state = read_levels(self);
+    int8_t step = quadrature_steps[(self->state << 2) | state];
+    self->state = state;
+    self->position += self->reverse ? -step : step;
+}
+
+bool quadrature_start_eic(quadrature_t* self, uint8_t pin_a, uint8_t eic_channel_a, uint8_t pin_b,
+                          uint8_t eic_channel_b, bool reverse) {
+    if (eic_channel_a == eic_channel_b || eic_channel_a >= EIC_EXTINT_NUM ||
+        eic_channel_b >= EIC_EXTINT_NUM ||
+        !eic_channel_free(eic_channel_a) || !eic_channel_free(eic_channel_b)) {
+        return false;
+    }
+    if (!eic_get_enable()) {
+        turn_on_external_interrupt_controller();
+    }
+    self->hardware = false;
+    self->reverse = reverse;
+    self->pin_a = pin_a;
+    self->pin_b = pin_b;
+    self->eic_channel_a = eic_channel_a;
+    self->eic_channel_b = eic_channel_b;
+    self->position = 0;
+    self->state = read_levels(self);
+
+    set_eic_channel_data(eic_channel_a, (void*) self);
+    set_eic_channel_data(eic_channel_b, (void*) self);
+    eic_set_callback(eic_channel_a, quadrature_eic_handler, self);
+    eic_set_callback(eic_channel_b, quadrature_eic_handler, self);
+    // Otherwise edges are lost while the SAMD51 has the EIC off to reconfigure other channels.
+    eic_set_replay_pin(eic_channel_a, pin_a);
+    eic_set_replay_pin(eic_channel_b, pin_b);
+    eic_channel_config_t configs[2] = {
+        {.eic_channel = eic_channel_a, .sense_setting = EIC_CONFIG_SENSE0_BOTH_Val | EIC_CONFIG_FILTEN0},
+        {.eic_channel = eic_channel_b, .sense_setting = EIC_CONFIG_SENSE0_BOTH_Val | EIC_CONFIG_FILTEN0},
+    };
+    eic_configure_channels(configs, 2);
+    EIC->INTENSET.reg = ((1u << eic_channel_a) | (1u << eic_channel_b)) << EIC_INTENSET_EXTINT_Pos;
+    turn_on_cpu_interrupt(eic_channel_a);
+    turn_on_cpu_interrupt(eic_channel_b);
+    // Catch an edge that came before the interrupts were on.
+    common_hal_mcu_disable_interrupts();
+    quadrature_eic_handler(self);
+    common_hal_mcu_enable_interrupts();
+    return true;
+}
+
+bool quadrature_start(quadrature_t* self, uint8_t pin_a, uint8_t eic_channel_a, uint8_t pin_b,
+                      uint8_t eic_channel_b, uint8_t timer_index, uint8_t gclk, bool reverse) {
+    if (quadrature_hardware_start(self, eic_channel_a, eic_channel_b, timer_index, gclk, reverse)) {
+        self->hardware = true;
+        self->reverse = reverse;
+        self->pin_a = pin_a;
+        self->pin_b = pin_b;
+        self->position = 0;
+        self->last_count = quadrature_hardware_count(self);
+        return true;
+    }
+    return quadrature_start_eic(self, pin_a, eic_channel_a, pin_b, eic_channel_b, reverse);
+}
+
+void quadrature_stop(quadrature_t* self) {
+    if (self->hardware) {
+        quadrature_hardware_stop(self);
+        return;
+    }
+    eic_channel_config_t configs[2] = {
+        {.eic_channel = self->eic_channel_a, .sense_setting = EIC_CONFIG_SENSE0_NONE_Val},
+        {.eic_channel = self->eic_channel_b, .sense_setting = EIC_CONFIG_SENSE0_NONE_Val},
+    };
+    eic_configure_channels(configs, 2);
+    turn_off_eic_channel(self->eic_channel_a);
+    turn_off_eic_channel(self->eic_channel_b);
+}
+
+int32_t quadrature_get_position(quadrature_t* self) {
+    if (!self->hardware) {
+        return self->position;
+    }
+    uint32_t count = quadrature_hardware_count(self);
+    uint32_t delta = (count - self->last_count) & self->count_mask;
+    self->last_count = count;
+    // Treat more than half a wrap as movement backwards.
+    if (delta > (self->count_mask >> 1)) {
+        self->position -= (int32_t) (self->count_mask - delta + 1);
+    } else {
+        self->position += (int32_t) delta;
+    }
+    return self->position;
+}
+
+void quadrature_set_position(quadrature_t* self, int32_t position) {
+    if (!self->hardware) {
+        // The interrupt adds to it.
+        common_hal_mcu_disable_interrupts();
+        self->position = position;
+        common_hal_mcu_enable_interrupts();
+        return;
+    }
+    self->last_count = quadrature_hardware_count(self);
+    self->position = position;
+}
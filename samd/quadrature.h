@@ -0,0 +1,83 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_QUADRATURE_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_QUADRATURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decodes a quadrature encoder. quadrature_start() decodes in hardware so that edges don't
+// interrupt the CPU, with the EIC channels of both pins driving the decoder through the event
+// system. When the hardware or its event channels are taken it falls back to decoding every edge
+// of both pins in their EIC interrupts, which quadrature_start_eic() always does.
+//
+// On the SAM_D5X_E5X the PDEC decodes every edge of both phases (4x). There is only one PDEC so
+// timer_index is ignored.
+//
+// On the SAMD21 the TCC at timer_index counts rising edges of phase A in the direction that the
+// level of phase B gives. That is step and direction counting rather than full decoding: it has 1x
+// resolution and chatter on A while B is steady counts every bounce the same way instead of
+// cancelling out. Use quadrature_start_eic() for encoders where that matters.
+//
+// The hardware counter is 16 or 24 bits wide and is extended to 32 bits whenever the position is
+// read, so read it at least once per half counter wrap.
+typedef struct {
+    volatile int32_t position;
+    uint32_t last_count;
+    uint32_t count_mask;
+    uint8_t timer_index;
+    uint8_t eic_channel_a;
+    uint8_t eic_channel_b;
+    uint8_t event_channel_a;
+    uint8_t event_channel_b;
+    uint8_t pin_a;
+    uint8_t pin_b;
+    uint8_t state;   // The EIC decoder's last levels of A and B.
+    bool hardware;
+    bool reverse;
+} quadrature_t;
+
+// Returns false when neither the hardware nor the EIC channels are free.
+bool quadrature_start(quadrature_t* self, uint8_t pin_a, uint8_t eic_channel_a, uint8_t pin_b,
+                      uint8_t eic_channel_b, uint8_t timer_index, uint8_t gclk, bool reverse);
+// 4x decoding on every chip at the cost of an interrupt per edge.
+bool quadrature_start_eic(quadrature_t* self, uint8_t pin_a, uint8_t eic_channel_a, uint8_t pin_b,
+                          uint8_t eic_channel_b, bool reverse);
+void quadrature_stop(quadrature_t* self);
+
+// Returns the position in counts since start, or the last quadrature_set_position().
+int32_t quadrature_get_position(quadrature_t* self);
+void quadrature_set_position(quadrature_t* self, int32_t position);
+
+// Chip specific. Starting returns false when the hardware or the EIC channels are already in use.
+// The count wraps at count_mask.
+bool quadrature_hardware_start(quadrature_t* self, uint8_t eic_channel_a, uint8_t eic_channel_b,
+                               uint8_t timer_index, uint8_t gclk, bool reverse);
+void quadrature_hardware_stop(quadrature_t* self);
+uint32_t quadrature_hardware_count(quadrature_t* self);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_QUADRATURE_H
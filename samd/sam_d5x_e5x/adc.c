@@ -27,17 +27,21 @@
 #include "hal/include/hal_adc_sync.h"
 #include "hpl/gclk/hpl_gclk_base.h"
 #include "hri_mclk.h"
+#include "samd/adc.h"
+#include "samd/bus_clocks.h"
+
+// Setup runs before every conversion so only the first one claims an ADC's clocks.
+static bool adc_on[2];
 
 // Do initialization and calibration setup needed for any use of the ADC.
 // The reference and resolution should be set by the caller.
 void samd_peripherals_adc_setup(struct adc_sync_descriptor *adc, Adc *instance) {
     // Turn the clocks on.
-    if (instance == ADC0) {
-        hri_mclk_set_APBDMASK_ADC0_bit(MCLK);
-        hri_gclk_write_PCHCTRL_reg(GCLK, ADC0_GCLK_ID, GCLK_PCHCTRL_GEN_GCLK1_Val | (1 << GCLK_PCHCTRL_CHEN_Pos));
-    } else if (instance == ADC1) {
-        hri_mclk_set_APBDMASK_ADC1_bit(MCLK);
-        hri_gclk_write_PCHCTRL_reg(GCLK, ADC1_GCLK_ID, GCLK_PCHCTRL_GEN_GCLK1_Val | (1 << GCLK_PCHCTRL_CHEN_Pos));
+    uint8_t index = instance == ADC0 ? 0 : 1;
+    if (!adc_on[index]) {
+        bus_clock_claim(BUS_APBD, index == 0 ? MCLK_APBDMASK_ADC0 : MCLK_APBDMASK_ADC1);
+        gclk_channel_claim(GCLK_PCHCTRL_GEN_GCLK1_Val, index == 0 ? ADC0_GCLK_ID : ADC1_GCLK_ID);
+        adc_on[index] = true;
     }
 
     adc_sync_init(adc, instance, (void *)NULL);
@@ -59,3 +63,13 @@ void samd_peripherals_adc_setup(struct adc_sync_descriptor *adc, Adc *instance)
     hri_adc_write_CALIB_BIASR2R_bf(instance, biasr2r);
     hri_adc_write_CALIB_BIASCOMP_bf(instance, biascomp);
 }
+
+void samd_peripherals_adc_release(Adc *instance) {
+    uint8_t index = instance == ADC0 ? 0 : 1;
+    if (!adc_on[index]) {
+        return;
+    }
+    gclk_channel_release(index == 0 ? ADC0_GCLK_ID : ADC1_GCLK_ID);
+    bus_clock_release(BUS_APBD, index == 0 ? MCLK_APBDMASK_ADC0 : MCLK_APBDMASK_ADC1);
+    adc_on[index] = false;
+}
@@ -24,7 +24,11 @@
  * THE SOFTWARE.
  */
 
+#include "samd/bus_clocks.h"
 #include "samd/clocks.h"
+#include "samd/sync.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
 
 #include "hpl_gclk_config.h"
 
@@ -33,20 +37,49 @@ bool gclk_enabled(uint8_t gclk) {
 }
 
 void disable_gclk(uint8_t gclk) {
-    while ((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0) {}
+    SYNC_WAIT((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0);
     GCLK->GENCTRL[gclk].bit.GENEN = false;
-    while ((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0) {}
+    SYNC_WAIT((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0);
 }
 
 void connect_gclk_to_peripheral(uint8_t gclk, uint8_t peripheral) {
     GCLK->PCHCTRL[peripheral].reg = GCLK_PCHCTRL_CHEN | GCLK_PCHCTRL_GEN(gclk);
-    while(GCLK->SYNCBUSY.reg != 0) {}
+    // PCHCTRL isn't synchronized through SYNCBUSY. CHEN reads back as set once the channel runs.
+    SYNC_WAIT(GCLK->PCHCTRL[peripheral].bit.CHEN == 0);
 }
 
 void disconnect_gclk_from_peripheral(uint8_t gclk, uint8_t peripheral) {
     GCLK->PCHCTRL[peripheral].reg = 0;
 }
 
+static volatile uint32_t* bus_clock_register(uint8_t bus) {
+    switch (bus) {
+        case BUS_AHB:
+            return &MCLK->AHBMASK.reg;
+        case BUS_APBA:
+            return &MCLK->APBAMASK.reg;
+        case BUS_APBB:
+            return &MCLK->APBBMASK.reg;
+        case BUS_APBC:
+            return &MCLK->APBCMASK.reg;
+        default:
+            return &MCLK->APBDMASK.reg;
+    }
+}
+
+void set_bus_clock(uint8_t bus, uint32_t mask, bool enable) {
+    volatile uint32_t* reg = bus_clock_register(bus);
+    if (enable) {
+        *reg |= mask;
+    } else {
+        *reg &= ~mask;
+    }
+}
+
+uint32_t get_bus_clocks(uint8_t bus) {
+    return *bus_clock_register(bus);
+}
+
 static void enable_clock_generator_sync(uint8_t gclk, uint32_t source, uint16_t divisor, bool sync) {
     uint32_t divsel = 0;
     // The datasheet says 8 bits and max value of 512, how is that possible?
@@ -62,7 +95,7 @@ static void enable_clock_generator_sync(uint8_t gclk, uint32_t source, uint16_t
 
     GCLK->GENCTRL[gclk].reg = GCLK_GENCTRL_SRC(source) | GCLK_GENCTRL_DIV(divisor) | divsel | GCLK_GENCTRL_OE | GCLK_GENCTRL_GENEN;
     if (sync)
-        while ((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0) {}
+        SYNC_WAIT((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0);
 }
 
 void enable_clock_generator(uint8_t gclk, uint32_t source, uint16_t divisor) {
@@ -71,7 +104,7 @@ void enable_clock_generator(uint8_t gclk, uint32_t source, uint16_t divisor) {
 
 void disable_clock_generator(uint8_t gclk) {
     GCLK->GENCTRL[gclk].reg = 0;
-    while ((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0) {}
+    SYNC_WAIT((GCLK->SYNCBUSY.vec.GENCTRL & (1 << gclk)) != 0);
 }
 
 static void init_clock_source_osculp32k(void) {
@@ -88,14 +121,203 @@ static void init_clock_source_xosc32k(void) {
                               OSC32KCTRL_XOSC32K_CGM(1);
 }
 
+static uint32_t xosc_frequencies[2];
+
+void clock_set_xosc_frequency(uint8_t xosc, uint32_t frequency) {
+    if (xosc >= sizeof(xosc_frequencies) / sizeof(xosc_frequencies[0])) {
+        return;
+    }
+    xosc_frequencies[xosc] = frequency;
+}
+
+bool dpll_solve(uint8_t refclk, uint32_t reference_frequency, uint32_t target, dpll_config_t* config) {
+    bool divided = refclk == OSCCTRL_DPLLCTRLB_REFCLK_XOSC0_Val ||
+                   refclk == OSCCTRL_DPLLCTRLB_REFCLK_XOSC1_Val;
+    return dpll_solve_reference(reference_frequency, divided, target, config);
+}
+
+// About 10ms with the CPU on the undivided DFLL, far beyond the datasheet's lock time.
+#define DPLL_LOCK_ATTEMPTS 60000
+
+// Returns false with the DPLL off when it doesn't lock in time.
+static bool write_dpll(uint8_t index, uint8_t refclk, const dpll_config_t* config) {
+    OSCCTRL->Dpll[index].DPLLCTRLA.reg = 0;
+    SYNC_WAIT(OSCCTRL->Dpll[index].DPLLSYNCBUSY.bit.ENABLE != 0);
+    OSCCTRL->Dpll[index].DPLLCTRLB.reg = OSCCTRL_DPLLCTRLB_REFCLK(refclk) |
+                                         OSCCTRL_DPLLCTRLB_DIV(config->div) |
+                                         OSCCTRL_DPLLCTRLB_FILTER(config->filter);
+    OSCCTRL->Dpll[index].DPLLRATIO.reg = OSCCTRL_DPLLRATIO_LDRFRAC(config->ldrfrac) |
+                                         OSCCTRL_DPLLRATIO_LDR(config->ldr);
+    SYNC_WAIT(OSCCTRL->Dpll[index].DPLLSYNCBUSY.bit.DPLLRATIO != 0);
+    OSCCTRL->Dpll[index].DPLLCTRLA.reg = OSCCTRL_DPLLCTRLA_ENABLE;
+    SYNC_WAIT(OSCCTRL->Dpll[index].DPLLSYNCBUSY.bit.ENABLE != 0);
+    for (uint32_t i = 0; i < DPLL_LOCK_ATTEMPTS; i++) {
+        if (OSCCTRL->Dpll[index].DPLLSTATUS.bit.LOCK && OSCCTRL->Dpll[index].DPLLSTATUS.bit.CLKRDY) {
+            return true;
+        }
+    }
+    OSCCTRL->Dpll[index].DPLLCTRLA.reg = 0;
+    SYNC_WAIT(OSCCTRL->Dpll[index].DPLLSYNCBUSY.bit.ENABLE != 0);
+    return false;
+}
+
+uint32_t dpll_reference_frequency(uint8_t refclk, uint8_t gclk) {
+    switch (refclk) {
+        case OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val:
+            return gclk_get_frequency(gclk);
+        case OSCCTRL_DPLLCTRLB_REFCLK_XOSC32_Val:
+            return 32768;
+        case OSCCTRL_DPLLCTRLB_REFCLK_XOSC0_Val:
+            return xosc_frequencies[0];
+        case OSCCTRL_DPLLCTRLB_REFCLK_XOSC1_Val:
+            return xosc_frequencies[1];
+    }
+    return 0;
+}
+
+// DPLL0 runs the CPU so it's only changed through clock_set_performance_level().
+bool dpll_start(uint8_t index, uint8_t refclk, uint8_t gclk, uint32_t target, dpll_config_t* config) {
+    if (index == 0 || index >= OSCCTRL_DPLLS_NUM ||
+        !dpll_solve(refclk, dpll_reference_frequency(refclk, gclk), target, config)) {
+        return false;
+    }
+    if (refclk == OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val) {
+        connect_gclk_to_peripheral(gclk, OSCCTRL_GCLK_ID_FDPLL0 + index);
+    }
+    if (!write_dpll(index, refclk, config)) {
+        dpll_stop(index);
+        return false;
+    }
+    return true;
+}
+
+void dpll_stop(uint8_t index) {
+    if (index == 0 || index >= OSCCTRL_DPLLS_NUM) {
+        return;
+    }
+    OSCCTRL->Dpll[index].DPLLCTRLA.reg = 0;
+    SYNC_WAIT(OSCCTRL->Dpll[index].DPLLSYNCBUSY.bit.ENABLE != 0);
+    if (OSCCTRL->Dpll[index].DPLLCTRLB.bit.REFCLK == OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val) {
+        disconnect_gclk_from_peripheral(GCLK->PCHCTRL[OSCCTRL_GCLK_ID_FDPLL0 + index].bit.GEN,
+                                        OSCCTRL_GCLK_ID_FDPLL0 + index);
+    }
+}
+
+// DPLL0's reference is GCLK5, the DFLL divided by 24.
+#define DPLL0_GCLK 5
+#define DPLL0_REFERENCE 2000000
+
+typedef struct {
+    uint32_t dpll0;  // DPLL0's output or zero to stop it and run from the DFLL.
+    uint8_t cpudiv;  // MCLK's division of GCLK0 for the CPU and its buses.
+} performance_setting_t;
+
+static const performance_setting_t performance_settings[] = {
+    [PERFORMANCE_LEVEL_12MHZ] = {0, 4},
+    [PERFORMANCE_LEVEL_48MHZ] = {0, 1},
+    [PERFORMANCE_LEVEL_120MHZ] = {120000000, 1},
+    [PERFORMANCE_LEVEL_200MHZ] = {200000000, 1},
+};
+
+static performance_level_t performance_level = PERFORMANCE_LEVEL_120MHZ;
+
+// Every performance level is an exact multiple of the reference so this only fails for a bad table.
+static bool solve_dpll0(performance_level_t level, dpll_config_t* config) {
+    return dpll_solve(OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val, DPLL0_REFERENCE,
+                      performance_settings[level].dpll0, config);
+}
+
+// GCLK0 and GCLK4 are the generators that follow DPLL0.
+static void set_dpll0_generators(uint32_t source, bool sync) {
+    enable_clock_generator_sync(0, source, 1, sync);
+    enable_clock_generator_sync(4, source, 1, sync);
+}
+
+static void stop_dpll0(void) {
+    OSCCTRL->Dpll[0].DPLLCTRLA.reg = 0;
+    SYNC_WAIT(OSCCTRL->Dpll[0].DPLLSYNCBUSY.bit.ENABLE != 0);
+}
+
+static void set_cpudiv(uint8_t cpudiv) {
+    if (MCLK->CPUDIV.reg == MCLK_CPUDIV_DIV(cpudiv)) {
+        return;
+    }
+    MCLK->INTFLAG.reg = MCLK_INTFLAG_CKRDY;
+    MCLK->CPUDIV.reg = MCLK_CPUDIV_DIV(cpudiv);
+    SYNC_WAIT(MCLK->INTFLAG.bit.CKRDY == 0);
+}
+
 static void init_clock_source_dpll0(void)
 {
-    GCLK->PCHCTRL[OSCCTRL_GCLK_ID_FDPLL0].reg = GCLK_PCHCTRL_CHEN | GCLK_PCHCTRL_GEN(5);
-    OSCCTRL->Dpll[0].DPLLRATIO.reg = OSCCTRL_DPLLRATIO_LDRFRAC(0) | OSCCTRL_DPLLRATIO_LDR(59);
-    OSCCTRL->Dpll[0].DPLLCTRLB.reg = OSCCTRL_DPLLCTRLB_REFCLK(0);
-    OSCCTRL->Dpll[0].DPLLCTRLA.reg = OSCCTRL_DPLLCTRLA_ENABLE;
+    GCLK->PCHCTRL[OSCCTRL_GCLK_ID_FDPLL0].reg = GCLK_PCHCTRL_CHEN | GCLK_PCHCTRL_GEN(DPLL0_GCLK);
+    dpll_config_t config;
+    // The CPU is still on the DFLL so it never waits on a DPLL that can't lock.
+    if (!solve_dpll0(PERFORMANCE_LEVEL_120MHZ, &config) ||
+        !write_dpll(0, OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val, &config)) {
+        set_dpll0_generators(GCLK_GENCTRL_SRC_DFLL_Val, false);
+        SystemCoreClock = 48000000;
+        performance_level = PERFORMANCE_LEVEL_48MHZ;
+        return;
+    }
+    set_dpll0_generators(GCLK_GENCTRL_SRC_DPLL0_Val, false);
+}
+
+// SysTick counts CPU cycles so scale its reload to keep the same period.
+static void rescale_systick(uint32_t old_frequency, uint32_t new_frequency) {
+    uint32_t running = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_CLKSOURCE_Msk;
+    if ((SysTick->CTRL & running) != running) {
+        return;
+    }
+    uint64_t reload = ((uint64_t) (SysTick->LOAD + 1) * new_frequency + old_frequency / 2) / old_frequency;
+    if (reload > SysTick_LOAD_RELOAD_Msk + 1) {
+        reload = SysTick_LOAD_RELOAD_Msk + 1;
+    }
+    SysTick->LOAD = reload - 1;
+}
+
+bool clock_set_performance_level(performance_level_t level) {
+    if ((uint32_t) level >= sizeof(performance_settings) / sizeof(performance_settings[0])) {
+        return false;
+    }
+    if (level == performance_level) {
+        return true;
+    }
+    const performance_setting_t* setting = &performance_settings[level];
+    dpll_config_t config;
+    if (setting->dpll0 != 0 && !solve_dpll0(level, &config)) {
+        return false;
+    }
+    clock_notify(CLOCK_CHANGE_BEFORE);
+    common_hal_mcu_disable_interrupts();
+    // Park everything that follows DPLL0 on the DFLL so nothing runs from it while it relocks or
+    // stops. Generators switch sources without glitching. The CPU stays undivided while DPLL0 locks
+    // so the timeout holds.
+    set_dpll0_generators(GCLK_GENCTRL_SRC_DFLL_Val, true);
+    set_cpudiv(1);
+    bool reached = true;
+    if (setting->dpll0 == 0) {
+        // Nothing needs it at the DFLL levels so don't pay for it.
+        stop_dpll0();
+    } else if (write_dpll(0, OSCCTRL_DPLLCTRLB_REFCLK_GCLK_Val, &config)) {
+        set_dpll0_generators(GCLK_GENCTRL_SRC_DPLL0_Val, true);
+    } else {
+        // Stay on the DFLL rather than wait forever with interrupts off.
+        reached = false;
+        level = PERFORMANCE_LEVEL_48MHZ;
+        setting = &performance_settings[level];
+    }
+    set_cpudiv(setting->cpudiv);
+    uint32_t old_frequency = SystemCoreClock;
+    SystemCoreClock = (setting->dpll0 != 0 ? setting->dpll0 : 48000000) / setting->cpudiv;
+    rescale_systick(old_frequency, SystemCoreClock);
+    performance_level = level;
+    common_hal_mcu_enable_interrupts();
+    clock_notify(CLOCK_CHANGE_AFTER);
+    return reached;
+}
 
-    while (!(OSCCTRL->Dpll[0].DPLLSTATUS.bit.LOCK || OSCCTRL->Dpll[0].DPLLSTATUS.bit.CLKRDY)) {}
+performance_level_t clock_get_performance_level(void) {
+    return performance_level;
 }
 
 void clock_init(bool has_crystal, uint32_t dfll48m_fine_calibration) {
@@ -113,12 +335,11 @@ void clock_init(bool has_crystal, uint32_t dfll48m_fine_calibration) {
 
     MCLK->CPUDIV.reg = MCLK_CPUDIV_DIV(1);
 
-    enable_clock_generator_sync(0, GCLK_GENCTRL_SRC_DPLL0_Val, 1, false);
     enable_clock_generator_sync(1, GCLK_GENCTRL_SRC_DFLL_Val, 1, false);
-    enable_clock_generator_sync(4, GCLK_GENCTRL_SRC_DPLL0_Val, 1, false);
     enable_clock_generator_sync(5, GCLK_GENCTRL_SRC_DFLL_Val, 24, false);
     enable_clock_generator_sync(6, GCLK_GENCTRL_SRC_DFLL_Val, 4, false);
 
+    // Also moves GCLK0 and GCLK4 onto DPLL0 once it has locked.
     init_clock_source_dpll0();
 
     // Do this after all static clock init so that they aren't used dynamically.
@@ -189,6 +410,17 @@ static uint32_t generator_get_frequency(uint8_t gen) {
         return osc_get_frequency(src) / div;
 }
 
+uint8_t gclk_get_source(uint8_t gclk) {
+    return generator_get_source(gclk);
+}
+
+uint32_t gclk_get_frequency(uint8_t gclk) {
+    if (!gclk_enabled(gclk)) {
+        return 0;
+    }
+    return generator_get_frequency(gclk);
+}
+
 static uint32_t dpll_get_frequency(uint8_t index) {
     uint8_t dpll_index = index - GCLK_SOURCE_DPLL0;
     uint32_t refclk = OSCCTRL->Dpll[dpll_index].DPLLCTRLB.bit.REFCLK;
@@ -203,6 +435,9 @@ static uint32_t dpll_get_frequency(uint8_t index) {
             break;
         case 0x2: // XOSC0
         case 0x3: // XOSC1
+            freq = xosc_frequencies[refclk - 0x2] /
+                   (2 * (OSCCTRL->Dpll[dpll_index].DPLLCTRLB.bit.DIV + 1));
+            break;
         default:
             return 0; // unknown
     }
@@ -214,8 +449,9 @@ static uint32_t dpll_get_frequency(uint8_t index) {
 static uint32_t osc_get_frequency(uint8_t index) {
     switch (index) {
         case GCLK_SOURCE_XOSC0:
+            return xosc_frequencies[0]; // zero until registered
         case GCLK_SOURCE_XOSC1:
-            return 0; // unknown
+            return xosc_frequencies[1];
         case GCLK_SOURCE_OSCULP32K:
         case GCLK_SOURCE_XOSC32K:
             return 32768;
@@ -89,6 +89,11 @@ uint8_t dma_transfer_status(uint8_t channel_number) {
     return channel->CHINTFLAG.reg;
 }
 
+void dma_clear_transfer_status(uint8_t channel_number, uint8_t flags) {
+    DmacChannel* channel = &DMAC->Channel[channel_number];
+    channel->CHINTFLAG.reg = flags;
+}
+
 bool dma_channel_free(uint8_t channel_number) {
     DmacChannel* channel = &DMAC->Channel[channel_number];
     return channel->CHSTATUS.reg == 0;
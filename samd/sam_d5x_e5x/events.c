@@ -26,19 +26,29 @@
 
 #include "samd/events.h"
 
-#include "samd/clocks.h"
+#include "samd/bus_clocks.h"
+#include "samd/sync.h"
 
 #include "py/runtime.h"
 
-#include "hri_mclk.h"
+// Everything in here shares a single claim on the event system's bus clock.
+static bool event_system_on;
 
 void turn_on_event_system(void) {
-    hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+    if (event_system_on) {
+        return;
+    }
+    bus_clock_claim(BUS_APBB, MCLK_APBBMASK_EVSYS);
+    event_system_on = true;
 }
 
 void reset_event_system(void) {
     EVSYS->CTRLA.bit.SWRST = true;
-    hri_mclk_clear_APBBMASK_EVSYS_bit(MCLK);
+    if (event_system_on) {
+        bus_clock_release(BUS_APBB, MCLK_APBBMASK_EVSYS);
+        event_system_on = false;
+    }
+    reset_event_claims();
 }
 
 bool event_channel_free(uint8_t channel) {
@@ -51,26 +61,119 @@ void disable_event_channel(uint8_t channel_number) {
     EVSYS->Channel[channel_number].CHANNEL.reg = 0;
 }
 
-void disable_event_user(uint8_t user_number) {
-    EVSYS->USER[user_number].reg = 0;
-}
-
-void connect_event_user_to_channel(uint8_t user, uint8_t channel) {
-    EVSYS->USER[user].reg = channel + 1;
+void route_event_user(uint8_t user, uint8_t channel) {
+    // Channel zero in USER means no channel.
+    uint8_t channel_setting = 0;
+    if (channel < EVSYS_CHANNELS) {
+        channel_setting = channel + 1;
+    }
+    EVSYS->USER[user].reg = channel_setting;
 }
 
 void init_async_event_channel(uint8_t channel, uint8_t generator) {
     EVSYS->Channel[channel].CHANNEL.reg = EVSYS_CHANNEL_EVGEN(generator) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS;
 }
 
-void init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator) {
-    connect_gclk_to_peripheral(gclk, EVSYS_GCLK_ID_0 + channel);
+bool init_resync_event_channel(uint8_t channel, uint8_t gclk, uint8_t generator) {
+    if (!event_channel_claim_gclk(channel, gclk)) {
+        return false;
+    }
+    EVSYS->Channel[channel].CHANNEL.reg = EVSYS_CHANNEL_EVGEN(generator) |
+                                          EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
+                                          EVSYS_CHANNEL_EDGSEL_RISING_EDGE;
+    return true;
+}
+
+bool trigger_software_event(uint8_t channel, uint8_t gclk) {
+    // SWEVT does nothing on the asynchronous path so resynchronize a rising edge instead.
+    if (!gclk_channel_claim(gclk, EVSYS_GCLK_ID_0 + channel)) {
+        return false;
+    }
+    EVSYS->Channel[channel].CHANNEL.reg = EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
+                                          EVSYS_CHANNEL_EDGSEL_RISING_EDGE;
+    EVSYS->SWEVT.reg = 1 << channel;
+    SYNC_WAIT(EVSYS->Channel[channel].CHSTATUS.bit.BUSYCH != 0);
+    gclk_channel_release(EVSYS_GCLK_ID_0 + channel);
+    return true;
+}
+
+bool init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator) {
+    if (!event_channel_claim_gclk(channel, gclk)) {
+        return false;
+    }
     EVSYS->Channel[channel].CHANNEL.reg = EVSYS_CHANNEL_EVGEN(generator) |
                                           EVSYS_CHANNEL_PATH_SYNCHRONOUS |
                                           EVSYS_CHANNEL_EDGSEL_RISING_EDGE;
     EVSYS->Channel[channel].CHINTFLAG.reg = EVSYS_CHINTFLAG_EVD | EVSYS_CHINTFLAG_OVR;
     EVSYS->Channel[channel].CHINTENSET.reg = EVSYS_CHINTENSET_EVD | EVSYS_CHINTENSET_OVR;
+    return true;
+}
+
+void enable_event_channel_irq(uint8_t channel) {
+    EVSYS->Channel[channel].CHINTENSET.reg = EVSYS_CHINTENSET_EVD | EVSYS_CHINTENSET_OVR;
+    // Channels 0 - 3 have their own interrupt lines and the rest share the last one.
+    if (channel < 4) {
+        NVIC_EnableIRQ(EVSYS_0_IRQn + channel);
+    } else {
+        NVIC_EnableIRQ(EVSYS_4_IRQn);
+    }
+}
+
+void disable_event_channel_irq(uint8_t channel) {
+    EVSYS->Channel[channel].CHINTENCLR.reg = EVSYS_CHINTENCLR_EVD | EVSYS_CHINTENCLR_OVR;
+    IRQn_Type irq = EVSYS_4_IRQn;
+    if (channel < 4) {
+        irq = EVSYS_0_IRQn + channel;
+    } else if ((event_callback_channels() & ~0xfUL) != 0) {
+        return;
+    }
+    NVIC_DisableIRQ(irq);
+    NVIC_ClearPendingIRQ(irq);
+}
+
+#if EVSYS_HANDLER
+static void evsys_handler(void) {
+    uint32_t pending = EVSYS->INTSTATUS.reg;
+    uint32_t callbacks = event_callback_channels();
+    uint32_t detected = 0;
+    uint32_t overflowed = 0;
+    while (pending != 0) {
+        uint8_t channel = __builtin_ctz(pending);
+        pending &= pending - 1;
+        // A channel without a callback would keep the line pending forever. Mask it and leave
+        // its flags for polling.
+        if ((callbacks & (1UL << channel)) == 0) {
+            EVSYS->Channel[channel].CHINTENCLR.reg = EVSYS_CHINTENCLR_EVD | EVSYS_CHINTENCLR_OVR;
+            continue;
+        }
+        uint8_t flags = EVSYS->Channel[channel].CHINTFLAG.reg & EVSYS->Channel[channel].CHINTENSET.reg;
+        EVSYS->Channel[channel].CHINTFLAG.reg = flags;
+        if ((flags & EVSYS_CHINTFLAG_EVD) != 0) {
+            detected |= 1UL << channel;
+        }
+        if ((flags & EVSYS_CHINTFLAG_OVR) != 0) {
+            overflowed |= 1UL << channel;
+        }
+    }
+    event_dispatch(detected, overflowed);
+}
+
+void EVSYS_0_Handler(void) {
+    evsys_handler();
+}
+void EVSYS_1_Handler(void) {
+    evsys_handler();
+}
+void EVSYS_2_Handler(void) {
+    evsys_handler();
+}
+void EVSYS_3_Handler(void) {
+    evsys_handler();
+}
+void EVSYS_4_Handler(void) {
+    evsys_handler();
 }
+#endif
 
 bool event_interrupt_active(uint8_t channel) {
     bool active = false;
@@ -28,21 +28,22 @@
 
 #include <stddef.h>
 
-#include "samd/clocks.h"
+#include "samd/bus_clocks.h"
+#include "samd/sync.h"
 #include "sam.h"
 
 void turn_on_external_interrupt_controller(void) {
-    MCLK->APBAMASK.bit.EIC_ = true;
+    bus_clock_claim(BUS_APBA, MCLK_APBAMASK_EIC);
 
     // We use the 48mhz clock to lightly filter the incoming pulse to reduce spurious interrupts.
-    connect_gclk_to_peripheral(GCLK_PCHCTRL_GEN_GCLK1_Val, EIC_GCLK_ID);
+    gclk_channel_claim(GCLK_PCHCTRL_GEN_GCLK1_Val, EIC_GCLK_ID);
     eic_set_enable(true);
 }
 
 void turn_off_external_interrupt_controller(void) {
     eic_set_enable(false);
-    MCLK->APBAMASK.bit.EIC_ = false;
-    disconnect_gclk_from_peripheral(GCLK_PCHCTRL_GEN_GCLK1_Val, EIC_GCLK_ID);
+    gclk_channel_release(EIC_GCLK_ID);
+    bus_clock_release(BUS_APBA, MCLK_APBAMASK_EIC);
 }
 
 void turn_on_cpu_interrupt(uint8_t eic_channel) {
@@ -54,33 +55,44 @@ void turn_on_cpu_interrupt(uint8_t eic_channel) {
     NVIC_EnableIRQ(EIC_0_IRQn + eic_channel);
 }
 
+// Every channel has its own line so a lower number lets it preempt the other channels' handlers.
+void eic_set_channel_priority(uint8_t eic_channel, uint8_t priority) {
+    NVIC_SetPriority(EIC_0_IRQn + eic_channel, priority);
+}
+
 bool eic_get_enable(void) {
     return EIC->CTRLA.bit.ENABLE;
 }
 
 void eic_set_enable(bool value) {
+    SYNC_WAIT(EIC->SYNCBUSY.bit.ENABLE != 0);
     EIC->CTRLA.bit.ENABLE = value;
-    while (EIC->SYNCBUSY.bit.ENABLE != 0) {}
+    // CONFIG, EVCTRL and the other enable-protected registers can only change once a disable has
+    // synchronized, and callers expect edges to be seen once an enable returns.
+    SYNC_WAIT(EIC->SYNCBUSY.bit.ENABLE != 0);
     // This won't actually block long enough in Rev A of SAMD51 and will miss edges in the first
     // three cycles of the peripheral clock. See the errata for details. It shouldn't impact us.
 }
 
 void eic_reset(void) {
     EIC->CTRLA.bit.SWRST = true;
-    while (EIC->SYNCBUSY.bit.SWRST != 0) {}
+    SYNC_WAIT(EIC->SYNCBUSY.bit.SWRST != 0);
     // This won't actually block long enough in Rev A of SAMD51 and will miss edges in the first
     // three cycles of the peripheral clock. See the errata for details. It shouldn't impact us.
     for (int i = 0; i < EIC_EXTINT_NUM; i++) {
         set_eic_channel_data(i, NULL);
+        eic_set_callback(i, NULL, NULL);
         NVIC_DisableIRQ(EIC_0_IRQn + i);
         NVIC_ClearPendingIRQ(EIC_0_IRQn + i);
     }
+    eic_clear_masks();
 }
 
 bool eic_channel_free(uint8_t eic_channel) {
     uint32_t mask = 1 << eic_channel;
     return get_eic_channel_data(eic_channel) == NULL &&
            (EIC->INTENSET.bit.EXTINT & mask) == 0 &&
+           (eic_masked_channels() & mask) == 0 &&
            (EIC->EVCTRL.bit.EXTINTEO & mask) == 0;
 }
 
@@ -26,27 +26,45 @@
 
 #include "samd/i2s.h"
 
+#include "samd/bus_clocks.h"
 #include "samd/clocks.h"
+#include "samd/sync.h"
 
 #include "hpl/gclk/hpl_gclk_base.h"
 
+static bool i2s_on;
+
 void turn_on_i2s(void) {
+    if (i2s_on) {
+        return;
+    }
     // Make sure the I2S peripheral is running so we can see if the resources we need are free.
-    hri_mclk_set_APBDMASK_I2S_bit(MCLK);
+    bus_clock_claim(BUS_APBD, MCLK_APBDMASK_I2S);
 
     // Connect the clock units to the 2mhz clock by default. They can't reset without it.
-    connect_gclk_to_peripheral(5, I2S_GCLK_ID_0);
-    connect_gclk_to_peripheral(5, I2S_GCLK_ID_1);
+    gclk_channel_claim(5, I2S_GCLK_ID_0);
+    gclk_channel_claim(5, I2S_GCLK_ID_1);
+    i2s_on = true;
+}
+
+void turn_off_i2s(void) {
+    if (!i2s_on) {
+        return;
+    }
+    gclk_channel_release(I2S_GCLK_ID_1);
+    gclk_channel_release(I2S_GCLK_ID_0);
+    bus_clock_release(BUS_APBD, MCLK_APBDMASK_I2S);
+    i2s_on = false;
 }
 
 void i2s_set_serializer_enable(uint8_t serializer, bool enable) {
     if (serializer == 0) {
-        while (I2S->SYNCBUSY.bit.TXEN == 1) {}
+        SYNC_WAIT(I2S->SYNCBUSY.bit.TXEN == 1);
         I2S->CTRLA.bit.TXEN = enable;
-        while (I2S->SYNCBUSY.bit.TXEN == 1) {}
+        SYNC_WAIT(I2S->SYNCBUSY.bit.TXEN == 1);
     } else {
-        while (I2S->SYNCBUSY.bit.RXEN == 1) {}
+        SYNC_WAIT(I2S->SYNCBUSY.bit.RXEN == 1);
         I2S->CTRLA.bit.RXEN = enable;
-        while (I2S->SYNCBUSY.bit.RXEN == 1) {}
+        SYNC_WAIT(I2S->SYNCBUSY.bit.RXEN == 1);
     }
 }
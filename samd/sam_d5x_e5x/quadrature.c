@@ -0,0 +1,114 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/quadrature.h"
+
+#include "samd/bus_clocks.h"
+#include "samd/events.h"
+#include "samd/external_interrupts.h"
+#include "samd/sync.h"
+
+#include "sam.h"
+
+#define PDEC_COUNT_MASK 0xffff
+
+uint32_t quadrature_hardware_count(quadrature_t* self) {
+    (void) self;
+    PDEC->CTRLBSET.reg = PDEC_CTRLBSET_CMD_READSYNC;
+    SYNC_WAIT(PDEC->SYNCBUSY.bit.CTRLB != 0 || PDEC->CTRLBSET.bit.CMD != 0);
+    SYNC_WAIT(PDEC->SYNCBUSY.bit.COUNT != 0);
+    return PDEC->COUNT.reg & PDEC_COUNT_MASK;
+}
+
+static void pdec_reset(void) {
+    PDEC->CTRLA.bit.SWRST = 1;
+    SYNC_WAIT(PDEC->CTRLA.bit.SWRST == 1 || PDEC->SYNCBUSY.bit.SWRST == 1);
+}
+
+bool quadrature_hardware_start(quadrature_t* self, uint8_t eic_channel_a, uint8_t eic_channel_b,
+                               uint8_t timer_index, uint8_t gclk, bool reverse) {
+    (void) timer_index;
+    if (eic_channel_a == eic_channel_b ||
+        !eic_channel_free(eic_channel_a) || !eic_channel_free(eic_channel_b)) {
+        return false;
+    }
+    if ((MCLK->APBCMASK.reg & MCLK_APBCMASK_PDEC) != 0 && PDEC->CTRLA.bit.ENABLE == 1) {
+        return false;
+    }
+
+    // Level sensing makes each event follow its pin. The PDEC ignores them until it starts below.
+    uint8_t event_channel_a = turn_on_eic_event_channel(eic_channel_a, EIC_CONFIG_SENSE0_HIGH_Val,
+                                                        EVSYS_ID_USER_PDEC_EVU_0, self);
+    if (event_channel_a >= EVSYS_CHANNELS) {
+        return false;
+    }
+    uint8_t event_channel_b = turn_on_eic_event_channel(eic_channel_b, EIC_CONFIG_SENSE0_HIGH_Val,
+                                                        EVSYS_ID_USER_PDEC_EVU_1, self);
+    if (event_channel_b >= EVSYS_CHANNELS) {
+        turn_off_eic_channel(eic_channel_a);
+        return false;
+    }
+
+    self->timer_index = 0;
+    self->eic_channel_a = eic_channel_a;
+    self->eic_channel_b = eic_channel_b;
+    self->event_channel_a = event_channel_a;
+    self->event_channel_b = event_channel_b;
+    self->count_mask = PDEC_COUNT_MASK;
+
+    // The gclk samples the phases so it must run well above the fastest edge rate.
+    if (!gclk_channel_claim(gclk, PDEC_GCLK_ID)) {
+        turn_off_eic_channel(eic_channel_a);
+        turn_off_eic_channel(eic_channel_b);
+        return false;
+    }
+    bus_clock_claim(BUS_APBC, MCLK_APBCMASK_PDEC);
+    pdec_reset();
+    // Phase inputs come from events rather than pins. A 16-bit angular count leaves no bits for
+    // revolutions, which we don't count without an index pulse anyway.
+    uint32_t ctrla = PDEC_CTRLA_MODE_QDEC | PDEC_CTRLA_CONF_X4 | PDEC_CTRLA_ANGULAR(7);
+    if (reverse) {
+        ctrla |= PDEC_CTRLA_SWAP;
+    }
+    PDEC->CTRLA.reg = ctrla;
+    PDEC->EVCTRL.reg = PDEC_EVCTRL_EVEI(0x3);
+    PDEC->CTRLA.bit.ENABLE = 1;
+    SYNC_WAIT(PDEC->SYNCBUSY.bit.ENABLE != 0);
+    PDEC->CTRLBSET.reg = PDEC_CTRLBSET_CMD_START;
+    SYNC_WAIT(PDEC->SYNCBUSY.bit.CTRLB != 0);
+    return true;
+}
+
+void quadrature_hardware_stop(quadrature_t* self) {
+    turn_off_eic_channel(self->eic_channel_a);
+    turn_off_eic_channel(self->eic_channel_b);
+
+    PDEC->CTRLA.bit.ENABLE = 0;
+    SYNC_WAIT(PDEC->SYNCBUSY.bit.ENABLE != 0);
+    pdec_reset();
+    gclk_channel_release(PDEC_GCLK_ID);
+    bus_clock_release(BUS_APBC, MCLK_APBCMASK_PDEC);
+}
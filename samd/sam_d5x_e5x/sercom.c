@@ -25,8 +25,8 @@
  */
 
 #include "hal/include/hal_adc_sync.h"
-#include "hpl/gclk/hpl_gclk_base.h"
-#include "hri_mclk.h"
+#include "samd/bus_clocks.h"
+#include "samd/sercom.h"
 
 // The clock initializer values are rather random, so we need to put them in
 // tables for lookup. We can't compute them.
@@ -63,46 +63,74 @@ static const uint8_t SERCOMx_GCLK_ID_SLOW[] = {
 
 Sercom* sercom_insts[SERCOM_INST_NUM] = SERCOM_INSTS;
 
-// Clock initialization as done in Atmel START.
-void samd_peripherals_sercom_clock_init(Sercom* sercom, uint8_t sercom_index) {
-	hri_gclk_write_PCHCTRL_reg(GCLK,
-                                   SERCOMx_GCLK_ID_CORE[sercom_index],
-                                   GCLK_PCHCTRL_GEN_GCLK1_Val | (1 << GCLK_PCHCTRL_CHEN_Pos));
-	hri_gclk_write_PCHCTRL_reg(GCLK,
-                                   SERCOMx_GCLK_ID_SLOW[sercom_index],
-                                   GCLK_PCHCTRL_GEN_GCLK3_Val | (1 << GCLK_PCHCTRL_CHEN_Pos));
-
-        // hri_mclk_set_APBAMASK_SERCOMx_bit is an inline, so let's use a switch, not a table.
-        switch (sercom_index) {
+// The SERCOMs are spread over three buses so use a switch, not a table.
+static void sercom_bus_clock(uint8_t sercom_index, uint8_t* bus, uint32_t* mask) {
+    *bus = BUS_APBD;
+    switch (sercom_index) {
         case 0:
-            hri_mclk_set_APBAMASK_SERCOM0_bit(MCLK);
+            *bus = BUS_APBA;
+            *mask = MCLK_APBAMASK_SERCOM0;
             break;
         case 1:
-            hri_mclk_set_APBAMASK_SERCOM1_bit(MCLK);
+            *bus = BUS_APBA;
+            *mask = MCLK_APBAMASK_SERCOM1;
             break;
         case 2:
-            hri_mclk_set_APBBMASK_SERCOM2_bit(MCLK);
+            *bus = BUS_APBB;
+            *mask = MCLK_APBBMASK_SERCOM2;
             break;
         case 3:
-            hri_mclk_set_APBBMASK_SERCOM3_bit(MCLK);
+            *bus = BUS_APBB;
+            *mask = MCLK_APBBMASK_SERCOM3;
             break;
         case 4:
-            hri_mclk_set_APBDMASK_SERCOM4_bit(MCLK);
+            *mask = MCLK_APBDMASK_SERCOM4;
             break;
         case 5:
-            hri_mclk_set_APBDMASK_SERCOM5_bit(MCLK);
+            *mask = MCLK_APBDMASK_SERCOM5;
             break;
 #ifdef SERCOM6
         case 6:
-            hri_mclk_set_APBDMASK_SERCOM6_bit(MCLK);
+            *mask = MCLK_APBDMASK_SERCOM6;
             break;
 #endif
 #ifdef SERCOM7
         case 7:
-            hri_mclk_set_APBDMASK_SERCOM7_bit(MCLK);
+            *mask = MCLK_APBDMASK_SERCOM7;
             break;
 #endif
-        }
+        default:
+            *mask = 0;
+            break;
+    }
+}
+
+// Clock initialization as done in Atmel START.
+void samd_peripherals_sercom_clock_init(Sercom* sercom, uint8_t sercom_index) {
+    (void) sercom;
+    uint8_t bus;
+    uint32_t mask;
+    sercom_bus_clock(sercom_index, &bus, &mask);
+    if (mask == 0) {
+        return;
+    }
+    bus_clock_claim(bus, mask);
+    gclk_channel_claim(GCLK_PCHCTRL_GEN_GCLK1_Val, SERCOMx_GCLK_ID_CORE[sercom_index]);
+    // Every SERCOM shares the slow channel.
+    gclk_channel_claim(GCLK_PCHCTRL_GEN_GCLK3_Val, SERCOMx_GCLK_ID_SLOW[sercom_index]);
+}
+
+void samd_peripherals_sercom_clock_deinit(Sercom* sercom, uint8_t sercom_index) {
+    (void) sercom;
+    uint8_t bus;
+    uint32_t mask;
+    sercom_bus_clock(sercom_index, &bus, &mask);
+    if (mask == 0) {
+        return;
+    }
+    gclk_channel_release(SERCOMx_GCLK_ID_SLOW[sercom_index]);
+    gclk_channel_release(SERCOMx_GCLK_ID_CORE[sercom_index]);
+    bus_clock_release(bus, mask);
 }
 
 
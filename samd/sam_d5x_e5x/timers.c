@@ -27,13 +27,15 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "samd/sync.h"
 #include "samd/timers.h"
 
 #include "timer_handler.h"
 
-#include "hri_gclk.h"
+#include "samd/bus_clocks.h"
 
 const uint8_t tcc_cc_num[5] = {6, 4, 3, 2, 2};
+const uint8_t tcc_counter_bits[5] = {24, 24, 16, 16, 16};
 const uint8_t tc_gclk_ids[TC_INST_NUM] = {TC0_GCLK_ID,
                                           TC1_GCLK_ID,
                                           TC2_GCLK_ID,
@@ -51,6 +53,40 @@ const uint8_t tc_gclk_ids[TC_INST_NUM] = {TC0_GCLK_ID,
                                           TC7_GCLK_ID,
 #endif
                                       };
+const uint8_t tc_ovf_dmac_ids[TC_INST_NUM] = {TC0_DMAC_ID_OVF,
+                                              TC1_DMAC_ID_OVF,
+                                              TC2_DMAC_ID_OVF,
+                                              TC3_DMAC_ID_OVF,
+#ifdef TC4_DMAC_ID_OVF
+                                              TC4_DMAC_ID_OVF,
+#endif
+#ifdef TC5_DMAC_ID_OVF
+                                              TC5_DMAC_ID_OVF,
+#endif
+#ifdef TC6_DMAC_ID_OVF
+                                              TC6_DMAC_ID_OVF,
+#endif
+#ifdef TC7_DMAC_ID_OVF
+                                              TC7_DMAC_ID_OVF,
+#endif
+                                          };
+const uint8_t tc_event_user_ids[TC_INST_NUM] = {EVSYS_ID_USER_TC0_EVU,
+                                                EVSYS_ID_USER_TC1_EVU,
+                                                EVSYS_ID_USER_TC2_EVU,
+                                                EVSYS_ID_USER_TC3_EVU,
+#ifdef EVSYS_ID_USER_TC4_EVU
+                                                EVSYS_ID_USER_TC4_EVU,
+#endif
+#ifdef EVSYS_ID_USER_TC5_EVU
+                                                EVSYS_ID_USER_TC5_EVU,
+#endif
+#ifdef EVSYS_ID_USER_TC6_EVU
+                                                EVSYS_ID_USER_TC6_EVU,
+#endif
+#ifdef EVSYS_ID_USER_TC7_EVU
+                                                EVSYS_ID_USER_TC7_EVU,
+#endif
+                                            };
 const uint8_t tcc_gclk_ids[TCC_INST_NUM] = {TCC0_GCLK_ID,
                                             TCC1_GCLK_ID,
                                             TCC2_GCLK_ID,
@@ -61,40 +97,62 @@ const uint8_t tcc_gclk_ids[TCC_INST_NUM] = {TCC0_GCLK_ID,
                                             TCC4_GCLK_ID
 #endif
                                     };
+const uint8_t tcc_ovf_dmac_ids[TCC_INST_NUM] = {TCC0_DMAC_ID_OVF,
+                                                TCC1_DMAC_ID_OVF,
+                                                TCC2_DMAC_ID_OVF,
+#ifdef TCC3_DMAC_ID_OVF
+                                                TCC3_DMAC_ID_OVF,
+#endif
+#ifdef TCC4_DMAC_ID_OVF
+                                                TCC4_DMAC_ID_OVF
+#endif
+                                        };
+const uint8_t tcc_event_user_ids[TCC_INST_NUM] = {EVSYS_ID_USER_TCC0_EV_0,
+                                                  EVSYS_ID_USER_TCC1_EV_0,
+                                                  EVSYS_ID_USER_TCC2_EV_0,
+#ifdef EVSYS_ID_USER_TCC3_EV_0
+                                                  EVSYS_ID_USER_TCC3_EV_0,
+#endif
+#ifdef EVSYS_ID_USER_TCC4_EV_0
+                                                  EVSYS_ID_USER_TCC4_EV_0
+#endif
+                                          };
 
-void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
-    uint8_t gclk_id;
-    if (is_tc) {
-        gclk_id = tc_gclk_ids[index];
-    } else {
-        gclk_id = tcc_gclk_ids[index];
-    }
-    // Turn on the clocks for the peripherals.
+static void timer_bus_clock(bool is_tc, uint8_t index, uint8_t* bus, uint32_t* mask) {
+    *mask = 0;
     if (is_tc) {
         switch (index) {
             case 0:
-                MCLK->APBAMASK.reg |= MCLK_APBAMASK_TC0;
+                *bus = BUS_APBA;
+                *mask = MCLK_APBAMASK_TC0;
                 break;
             case 1:
-                MCLK->APBAMASK.reg |= MCLK_APBAMASK_TC1;
+                *bus = BUS_APBA;
+                *mask = MCLK_APBAMASK_TC1;
                 break;
             case 2:
-                MCLK->APBBMASK.reg |= MCLK_APBBMASK_TC2;
+                *bus = BUS_APBB;
+                *mask = MCLK_APBBMASK_TC2;
                 break;
             case 3:
-                MCLK->APBBMASK.reg |= MCLK_APBBMASK_TC3;
+                *bus = BUS_APBB;
+                *mask = MCLK_APBBMASK_TC3;
                 break;
             case 4:
-                MCLK->APBCMASK.reg |= MCLK_APBCMASK_TC4;
+                *bus = BUS_APBC;
+                *mask = MCLK_APBCMASK_TC4;
                 break;
             case 5:
-                MCLK->APBCMASK.reg |= MCLK_APBCMASK_TC5;
+                *bus = BUS_APBC;
+                *mask = MCLK_APBCMASK_TC5;
                 break;
             case 6:
-                MCLK->APBDMASK.reg |= MCLK_APBDMASK_TC6;
+                *bus = BUS_APBD;
+                *mask = MCLK_APBDMASK_TC6;
                 break;
             case 7:
-                MCLK->APBDMASK.reg |= MCLK_APBDMASK_TC7;
+                *bus = BUS_APBD;
+                *mask = MCLK_APBDMASK_TC7;
                 break;
             default:
                 break;
@@ -102,38 +160,124 @@ void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
     } else {
         switch (index) {
             case 0:
-                MCLK->APBBMASK.reg |= MCLK_APBBMASK_TCC0;
+                *bus = BUS_APBB;
+                *mask = MCLK_APBBMASK_TCC0;
                 break;
             case 1:
-                MCLK->APBBMASK.reg |= MCLK_APBBMASK_TCC1;
+                *bus = BUS_APBB;
+                *mask = MCLK_APBBMASK_TCC1;
                 break;
             case 2:
-                MCLK->APBCMASK.reg |= MCLK_APBCMASK_TCC2;
+                *bus = BUS_APBC;
+                *mask = MCLK_APBCMASK_TCC2;
                 break;
             case 3:
-                MCLK->APBCMASK.reg |= MCLK_APBCMASK_TCC3;
+                *bus = BUS_APBC;
+                *mask = MCLK_APBCMASK_TCC3;
                 break;
             case 4:
-                MCLK->APBDMASK.reg |= MCLK_APBDMASK_TCC4;
+                *bus = BUS_APBD;
+                *mask = MCLK_APBDMASK_TCC4;
                 break;
             default:
                 break;
         }
     }
+}
 
+void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
+    uint8_t bus;
+    uint32_t mask;
+    timer_bus_clock(is_tc, index, &bus, &mask);
+    if (mask != 0) {
+        bus_clock_pin(bus, mask);
+    }
     // FIXME(tannewt): TC4-TC7 can only have 100mhz inputs.
+    gclk_channel_connect(gclk_index, is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index]);
+}
 
-    hri_gclk_write_PCHCTRL_reg(GCLK, gclk_id,
-                               gclk_index | (1 << GCLK_PCHCTRL_CHEN_Pos));
+bool timer_claim_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
+    if (!gclk_channel_claim(gclk_index, is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index])) {
+        return false;
+    }
+    uint8_t bus;
+    uint32_t mask;
+    timer_bus_clock(is_tc, index, &bus, &mask);
+    if (mask != 0) {
+        bus_clock_claim(bus, mask);
+    }
+    return true;
+}
+
+void timer_release_clocks(bool is_tc, uint8_t index) {
+    uint8_t bus;
+    uint32_t mask;
+    timer_bus_clock(is_tc, index, &bus, &mask);
+    gclk_channel_release(is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index]);
+    if (mask != 0) {
+        bus_clock_release(bus, mask);
+    }
 }
 
 void tc_set_enable(Tc* tc, bool enable) {
+    // CTRLA writes are dropped while an earlier one is still synchronizing.
+    SYNC_WAIT(tc->COUNT16.SYNCBUSY.bit.ENABLE != 0);
     tc->COUNT16.CTRLA.bit.ENABLE = enable;
-    while (tc->COUNT16.SYNCBUSY.bit.ENABLE != 0) {
-        /* Wait for sync */
-    }
+    // Enable-protected registers can only change once a disable has synchronized, and callers
+    // expect the timer to be counting once an enable returns.
+    SYNC_WAIT(tc->COUNT16.SYNCBUSY.bit.ENABLE != 0);
 }
 
 void tc_wait_for_sync(Tc* tc) {
-    while (tc->COUNT16.SYNCBUSY.reg != 0) {}
+    SYNC_WAIT(tc->COUNT16.SYNCBUSY.reg != 0);
+}
+
+// Set up a disabled TC to overflow at the period found by timer_solve_period().
+void tc_configure_period(Tc* tc, const timer_period_t* period) {
+    uint32_t prescaler_setting = TC_CTRLA_PRESCALER(period->prescaler_index);
+    if (period->counter_bits == 8) {
+        tc->COUNT8.CTRLA.reg = TC_CTRLA_MODE_COUNT8 | prescaler_setting;
+        tc->COUNT8.WAVE.reg = TC_WAVE_WAVEGEN_NFRQ;
+        tc->COUNT8.PER.reg = period->top;
+    } else if (period->counter_bits == 16) {
+        tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | prescaler_setting;
+        tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+        tc->COUNT16.CC[0].reg = period->top;
+    } else {
+        tc->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | prescaler_setting;
+        tc->COUNT32.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+        tc->COUNT32.CC[0].reg = period->top;
+    }
+    tc_wait_for_sync(tc);
+}
+
+// Set up a disabled TC as a 16-bit counter that captures into both channels on its event input.
+void tc_configure_capture(Tc* tc, uint8_t prescaler_index, uint8_t event_action, bool invert_event) {
+    tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 |
+                            TC_CTRLA_PRESCALER(prescaler_index) |
+                            TC_CTRLA_CAPTEN0 |
+                            TC_CTRLA_CAPTEN1;
+    uint16_t invert = 0;
+    if (invert_event) {
+        invert = TC_EVCTRL_TCINV;
+    }
+    tc->COUNT16.EVCTRL.reg = TC_EVCTRL_TCEI | TC_EVCTRL_EVACT(event_action) | invert;
+    tc_wait_for_sync(tc);
+}
+
+// The SAMD51 has no continuous read. Every read of COUNT is requested with a READSYNC command.
+void tc_enable_continuous_read(Tc* tc) {
+    (void) tc;
+}
+
+uint16_t tc_read_count16(Tc* tc) {
+    tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_READSYNC;
+    SYNC_WAIT(tc->COUNT16.SYNCBUSY.bit.CTRLB != 0 || tc->COUNT16.CTRLBSET.bit.CMD != 0);
+    return tc->COUNT16.COUNT.reg;
+}
+
+uint32_t tc_read_count32(Tc* tc) {
+    tc->COUNT32.CTRLBSET.reg = TC_CTRLBSET_CMD_READSYNC;
+    SYNC_WAIT(tc->COUNT32.SYNCBUSY.bit.CTRLB != 0 || tc->COUNT32.CTRLBSET.bit.CMD != 0);
+    return tc->COUNT32.COUNT.reg;
 }
@@ -25,15 +25,21 @@
  */
 
 #include "hal/include/hal_adc_sync.h"
-#include "hpl/gclk/hpl_gclk_base.h"
-#include "hpl/pm/hpl_pm_base.h"
+#include "samd/adc.h"
+#include "samd/bus_clocks.h"
+
+// Setup runs before every conversion so only the first one claims the clocks.
+static bool adc_on;
 
 // Do initialization and calibration setup needed for any use of the ADC.
 // The reference and resolution should be set by the caller.
 void samd_peripherals_adc_setup(struct adc_sync_descriptor *adc, Adc *instance) {
     // Turn the clocks on.
-    _pm_enable_bus_clock(PM_BUS_APBC, ADC);
-    _gclk_enable_channel(ADC_GCLK_ID, GCLK_CLKCTRL_GEN_GCLK0_Val);
+    if (!adc_on) {
+        bus_clock_claim(BUS_APBC, PM_APBCMASK_ADC);
+        gclk_channel_claim(GCLK_CLKCTRL_GEN_GCLK0_Val, ADC_GCLK_ID);
+        adc_on = true;
+    }
 
     adc_sync_init(adc, instance, (void *)NULL);
 
@@ -45,3 +51,13 @@ void samd_peripherals_adc_setup(struct adc_sync_descriptor *adc, Adc *instance)
     linearity |= (*((uint32_t*) ADC_FUSES_LINEARITY_0_ADDR) & ADC_FUSES_LINEARITY_0_Msk) >> ADC_FUSES_LINEARITY_0_Pos;
     hri_adc_write_CALIB_LINEARITY_CAL_bf(ADC, linearity);
 }
+
+void samd_peripherals_adc_release(Adc *instance) {
+    (void) instance;
+    if (!adc_on) {
+        return;
+    }
+    gclk_channel_release(ADC_GCLK_ID);
+    bus_clock_release(BUS_APBC, PM_APBCMASK_ADC);
+    adc_on = false;
+}
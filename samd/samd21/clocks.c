@@ -25,54 +25,135 @@
  */
 
 #include "hal_atomic.h"
+#include "samd/bus_clocks.h"
 #include "samd/clocks.h"
-
-bool gclk_enabled(uint8_t gclk) {
+#include "samd/sync.h"
+
+// Reading a GCLK register back takes a byte write to select it and a wait for synchronization, all
+// with interrupts off so nothing else selects another in between. Instead we keep a copy of the
+// clock tree that's updated whenever this file changes it so that queries are plain loads. Each
+// entry is a single byte or word so updating it doesn't need interrupts off either. Entries that
+// say off are read back again when queried so that clocks turned on elsewhere are still seen.
+#define CLOCK_TREE_OFF 0xff
+
+static uint8_t generator_sources[GCLK_GEN_NUM] = {[0 ... GCLK_GEN_NUM - 1] = CLOCK_TREE_OFF};
+static uint32_t generator_divisors[GCLK_GEN_NUM];
+static uint8_t channel_generators[GCLK_NUM] = {[0 ... GCLK_NUM - 1] = CLOCK_TREE_OFF};
+
+// Explicitly do a byte write so the peripheral knows we're just wanting to read the channel
+// rather than write to it.
+static void read_generator(uint8_t gen) {
     volatile hal_atomic_t atomic;
     atomic_enter_critical(&atomic);
+    *((uint8_t*) &GCLK->GENCTRL.reg) = gen;
+    *((uint8_t*) &GCLK->GENDIV.reg) = gen;
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY == 1);
+    uint32_t div;
+    if (GCLK->GENCTRL.bit.DIVSEL) {
+        div = 1 << (GCLK->GENDIV.bit.DIV + 1);
+    } else {
+        div = GCLK->GENDIV.bit.DIV;
+        if (!div)
+            div = 1;
+    }
+    generator_divisors[gen] = div;
+    generator_sources[gen] = GCLK->GENCTRL.bit.GENEN ? GCLK->GENCTRL.bit.SRC : CLOCK_TREE_OFF;
+    atomic_leave_critical(&atomic);
+}
 
-    // Explicitly do a byte write so the peripheral knows we're just wanting to read the channel
-    // rather than write to it.
-    *((uint8_t*) &GCLK->GENCTRL.reg) = gclk;
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
-    bool enabled = GCLK->GENCTRL.bit.GENEN;
+static void read_channel(uint8_t clk) {
+    volatile hal_atomic_t atomic;
+    atomic_enter_critical(&atomic);
+    *((uint8_t*) &GCLK->CLKCTRL.reg) = clk;
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY == 1);
+    channel_generators[clk] = GCLK->CLKCTRL.bit.CLKEN ? GCLK->CLKCTRL.bit.GEN : CLOCK_TREE_OFF;
     atomic_leave_critical(&atomic);
-    return enabled;
+}
+
+void clock_tree_refresh(void) {
+    for (uint8_t i = 0; i < GCLK_GEN_NUM; i++) {
+        read_generator(i);
+    }
+    for (uint8_t i = 0; i < GCLK_NUM; i++) {
+        read_channel(i);
+    }
+}
+
+bool gclk_enabled(uint8_t gclk) {
+    if (generator_sources[gclk] == CLOCK_TREE_OFF) {
+        read_generator(gclk);
+    }
+    return generator_sources[gclk] != CLOCK_TREE_OFF;
 }
 
 void disable_gclk(uint8_t gclk) {
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
+    generator_sources[gclk] = CLOCK_TREE_OFF;
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY == 1);
     GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(gclk);
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY == 1);
 }
 
 void connect_gclk_to_peripheral(uint8_t gclk, uint8_t peripheral) {
     GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID(peripheral) | GCLK_CLKCTRL_GEN(gclk) | GCLK_CLKCTRL_CLKEN;
+    channel_generators[peripheral] = gclk;
 }
 
 void disconnect_gclk_from_peripheral(uint8_t gclk, uint8_t peripheral) {
+    channel_generators[peripheral] = CLOCK_TREE_OFF;
     GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID(peripheral) | GCLK_CLKCTRL_GEN(gclk);
 }
 
+static volatile uint32_t* bus_clock_register(uint8_t bus) {
+    switch (bus) {
+        case BUS_AHB:
+            return &PM->AHBMASK.reg;
+        case BUS_APBA:
+            return &PM->APBAMASK.reg;
+        case BUS_APBB:
+            return &PM->APBBMASK.reg;
+        default:
+            return &PM->APBCMASK.reg;
+    }
+}
+
+void set_bus_clock(uint8_t bus, uint32_t mask, bool enable) {
+    volatile uint32_t* reg = bus_clock_register(bus);
+    if (enable) {
+        *reg |= mask;
+    } else {
+        *reg &= ~mask;
+    }
+}
+
+uint32_t get_bus_clocks(uint8_t bus) {
+    return *bus_clock_register(bus);
+}
+
 void enable_clock_generator(uint8_t gclk, uint32_t source, uint16_t divisor) {
     uint32_t divsel = 0;
+    uint32_t effective_divisor = divisor == 0 ? 1 : divisor;
     if (gclk == 2 && divisor > 31) {
         divsel = GCLK_GENCTRL_DIVSEL;
         for (int i = 15; i > 4; i--) {
             if (divisor & (1 << i)) {
                 divisor = i - 1;
+                effective_divisor = 1 << i;
                 break;
             }
         }
     }
     GCLK->GENDIV.reg = GCLK_GENDIV_ID(gclk) | GCLK_GENDIV_DIV(divisor);
     GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(gclk) | GCLK_GENCTRL_SRC(source) | divsel | GCLK_GENCTRL_OE | GCLK_GENCTRL_GENEN;
-    while (GCLK->STATUS.bit.SYNCBUSY != 0) {}
+    // The divisor goes first so that a query never pairs the new source with the old divisor.
+    generator_divisors[gclk] = effective_divisor;
+    generator_sources[gclk] = source;
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY != 0);
 }
 
 void disable_clock_generator(uint8_t gclk) {
+    generator_sources[gclk] = CLOCK_TREE_OFF;
     GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(gclk);
-    while (GCLK->STATUS.bit.SYNCBUSY != 0) {}
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY != 0);
 }
 
 static void init_clock_source_osc8m(void) {
@@ -116,7 +197,7 @@ static void init_clock_source_dfll48m_xosc(void) {
     SYSCTRL->DFLLCTRL.reg = SYSCTRL_DFLLCTRL_MODE |
                             SYSCTRL_DFLLCTRL_ENABLE;
     while (!SYSCTRL->PCLKSR.bit.DFLLRDY) {}
-    while (GCLK->STATUS.bit.SYNCBUSY) {}
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY);
 
     // Wait for the fine lock on the DFLL.
     while (!SYSCTRL->PCLKSR.bit.DFLLLCKC || !SYSCTRL->PCLKSR.bit.DFLLLCKF) {}
@@ -139,7 +220,7 @@ static void init_clock_source_dfll48m_usb(uint32_t fine_calibration) {
                             SYSCTRL_DFLLCTRL_MODE |
                             SYSCTRL_DFLLCTRL_ENABLE;
     while (!SYSCTRL->PCLKSR.bit.DFLLRDY) {}
-    while (GCLK->STATUS.bit.SYNCBUSY) {}
+    SYNC_WAIT(GCLK->STATUS.bit.SYNCBUSY);
 }
 
 void clock_init(bool has_crystal, uint32_t dfll48m_fine_calibration)
@@ -166,38 +247,30 @@ void clock_init(bool has_crystal, uint32_t dfll48m_fine_calibration)
         enable_clock_generator(2, GCLK_GENCTRL_SRC_OSC32K_Val, 1);
     }
 
+    // Pick up what the bootloader and reset left running as well as what we just set up.
+    clock_tree_refresh();
+
     // Do this after all static clock init so that they aren't used dynamically.
     init_dynamic_clocks();
 }
 
 static bool clk_enabled(uint8_t clk) {
-    volatile hal_atomic_t atomic;
-    atomic_enter_critical(&atomic);
-    *((uint8_t*) &GCLK->CLKCTRL.reg) = clk;
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
-    bool enabled = GCLK->CLKCTRL.bit.CLKEN;
-    atomic_leave_critical(&atomic);
-    return enabled;
+    if (clk >= GCLK_NUM) {
+        return false;
+    }
+    if (channel_generators[clk] == CLOCK_TREE_OFF) {
+        read_channel(clk);
+    }
+    return channel_generators[clk] != CLOCK_TREE_OFF;
 }
 
 static uint8_t clk_get_generator(uint8_t clk) {
-    volatile hal_atomic_t atomic;
-    atomic_enter_critical(&atomic);
-    *((uint8_t*) &GCLK->CLKCTRL.reg) = clk;
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
-    uint8_t gen = GCLK->CLKCTRL.bit.GEN;
-    atomic_leave_critical(&atomic);
-    return gen;
+    return channel_generators[clk];
 }
 
 static uint8_t generator_get_source(uint8_t gen) {
-    volatile hal_atomic_t atomic;
-    atomic_enter_critical(&atomic);
-    *((uint8_t*) &GCLK->GENCTRL.reg) = gen;
-    while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
-    uint8_t src = GCLK->GENCTRL.bit.SRC;
-    atomic_leave_critical(&atomic);
-    return src;
+    gclk_enabled(gen);
+    return generator_sources[gen];
 }
 
 static bool osc_enabled(uint8_t index) {
@@ -242,6 +315,17 @@ static uint32_t osc_get_frequency(uint8_t index) {
     return 0;
 }
 
+uint8_t gclk_get_source(uint8_t gclk) {
+    return generator_get_source(gclk);
+}
+
+uint32_t gclk_get_frequency(uint8_t gclk) {
+    if (!gclk_enabled(gclk)) {
+        return 0;
+    }
+    return osc_get_frequency(generator_sources[gclk]) / generator_divisors[gclk];
+}
+
 bool clock_get_enabled(uint8_t type, uint8_t index) {
     if (type == 0)
         return osc_enabled(index);
@@ -274,26 +358,7 @@ uint32_t clock_get_frequency(uint8_t type, uint8_t index) {
         if (!clk_enabled(index))
             return 0;
 
-        uint8_t gen = clk_get_generator(index);
-
-        volatile hal_atomic_t atomic;
-        atomic_enter_critical(&atomic);
-        *((uint8_t*) &GCLK->GENCTRL.reg) = gen;
-        *((uint8_t*) &GCLK->GENDIV.reg) = gen;
-        while (GCLK->STATUS.bit.SYNCBUSY == 1) {}
-
-        uint8_t src = GCLK->GENCTRL.bit.SRC;
-        uint32_t div;
-        if (GCLK->GENCTRL.bit.DIVSEL) {
-            div = 1 << (GCLK->GENDIV.bit.DIV + 1);
-        } else {
-            div = GCLK->GENDIV.bit.DIV;
-            if (!div)
-                div = 1;
-        }
-        atomic_leave_critical(&atomic);
-
-        return osc_get_frequency(src) / div;
+        return gclk_get_frequency(clk_get_generator(index));
     }
     if (type == 2 && index == 0) {
         return clock_get_frequency(0, generator_get_source(0)) / SysTick->LOAD;
@@ -109,6 +109,13 @@ uint8_t dma_transfer_status(uint8_t channel_number) {
     return status;
 }
 
+void dma_clear_transfer_status(uint8_t channel_number, uint8_t flags) {
+    common_hal_mcu_disable_interrupts();
+    DMAC->CHID.reg = DMAC_CHID_ID(channel_number);
+    DMAC->CHINTFLAG.reg = flags;
+    common_hal_mcu_enable_interrupts();
+}
+
 bool dma_channel_free(uint8_t channel_number) {
     common_hal_mcu_disable_interrupts();
     DMAC->CHID.reg = DMAC_CHID_ID(channel_number);
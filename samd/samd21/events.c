@@ -26,19 +26,29 @@
 
 #include "samd/events.h"
 
-#include "samd/clocks.h"
+#include "samd/bus_clocks.h"
+#include "samd/sync.h"
 
 #include "py/runtime.h"
 
-#include "hpl/pm/hpl_pm_base.h"
+// Everything in here shares a single claim on the event system's bus clock.
+static bool event_system_on;
 
 void turn_on_event_system(void) {
-    _pm_enable_bus_clock(PM_BUS_APBC, EVSYS);
+    if (event_system_on) {
+        return;
+    }
+    bus_clock_claim(BUS_APBC, PM_APBCMASK_EVSYS);
+    event_system_on = true;
 }
 
 void reset_event_system(void) {
     EVSYS->CTRL.bit.SWRST = true;
-    _pm_disable_bus_clock(PM_BUS_APBC, EVSYS);
+    if (event_system_on) {
+        bus_clock_release(BUS_APBC, PM_APBCMASK_EVSYS);
+        event_system_on = false;
+    }
+    reset_event_claims();
 }
 
 bool event_channel_free(uint8_t channel) {
@@ -54,12 +64,13 @@ void disable_event_channel(uint8_t channel_number) {
     EVSYS->CHANNEL.reg = EVSYS_CHANNEL_CHANNEL(channel_number);
 }
 
-void disable_event_user(uint8_t user_number) {
-    EVSYS->USER.reg = EVSYS_USER_USER(user_number);
-}
-
-void connect_event_user_to_channel(uint8_t user, uint8_t channel) {
-    EVSYS->USER.reg = EVSYS_USER_USER(user) | EVSYS_USER_CHANNEL(channel + 1);
+void route_event_user(uint8_t user, uint8_t channel) {
+    // Channel zero in USER means no channel.
+    uint8_t channel_setting = 0;
+    if (channel < EVSYS_CHANNELS) {
+        channel_setting = channel + 1;
+    }
+    EVSYS->USER.reg = EVSYS_USER_USER(user) | EVSYS_USER_CHANNEL(channel_setting);
 }
 
 void init_async_event_channel(uint8_t channel, uint8_t generator) {
@@ -68,8 +79,42 @@ void init_async_event_channel(uint8_t channel, uint8_t generator) {
                          EVSYS_CHANNEL_PATH_ASYNCHRONOUS;
 }
 
-void init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator) {
-    connect_gclk_to_peripheral(gclk, EVSYS_GCLK_ID_0 + channel);
+bool init_resync_event_channel(uint8_t channel, uint8_t gclk, uint8_t generator) {
+    if (!event_channel_claim_gclk(channel, gclk)) {
+        return false;
+    }
+    EVSYS->CHANNEL.reg = EVSYS_CHANNEL_CHANNEL(channel) |
+                         EVSYS_CHANNEL_EVGEN(generator) |
+                         EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
+                         EVSYS_CHANNEL_EDGSEL_RISING_EDGE;
+    return true;
+}
+
+bool trigger_software_event(uint8_t channel, uint8_t gclk) {
+    // SWEVT does nothing on the asynchronous path so resynchronize a rising edge instead.
+    if (!gclk_channel_claim(gclk, EVSYS_GCLK_ID_0 + channel)) {
+        return false;
+    }
+    uint32_t setting = EVSYS_CHANNEL_CHANNEL(channel) |
+                       EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
+                       EVSYS_CHANNEL_EDGSEL_RISING_EDGE;
+    EVSYS->CHANNEL.reg = setting;
+    EVSYS->CHANNEL.reg = setting | EVSYS_CHANNEL_SWEVT;
+    uint32_t busy;
+    if (channel >= 8) {
+        busy = EVSYS_CHSTATUS_CHBUSYp8(1 << (channel - 8));
+    } else {
+        busy = EVSYS_CHSTATUS_CHBUSY(1 << channel);
+    }
+    SYNC_WAIT((EVSYS->CHSTATUS.reg & busy) != 0);
+    gclk_channel_release(EVSYS_GCLK_ID_0 + channel);
+    return true;
+}
+
+bool init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generator) {
+    if (!event_channel_claim_gclk(channel, gclk)) {
+        return false;
+    }
     EVSYS->CHANNEL.reg = EVSYS_CHANNEL_CHANNEL(channel) |
                          EVSYS_CHANNEL_EVGEN(generator) |
                          EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
@@ -83,7 +128,56 @@ void init_event_channel_interrupt(uint8_t channel, uint8_t gclk, uint8_t generat
         EVSYS->INTFLAG.reg = EVSYS_INTFLAG_EVD(value) | EVSYS_INTFLAG_OVR(value);
         EVSYS->INTENSET.reg = EVSYS_INTENSET_EVD(value) | EVSYS_INTENSET_OVR(value);
     }
+    return true;
+}
+
+static uint32_t channel_interrupts(uint8_t channel) {
+    if (channel >= 8) {
+        uint8_t value = 1 << (channel - 8);
+        return EVSYS_INTENSET_EVDp8(value) | EVSYS_INTENSET_OVRp8(value);
+    }
+    uint8_t value = 1 << channel;
+    return EVSYS_INTENSET_EVD(value) | EVSYS_INTENSET_OVR(value);
+}
+
+void enable_event_channel_irq(uint8_t channel) {
+    EVSYS->INTENSET.reg = channel_interrupts(channel);
+    NVIC_EnableIRQ(EVSYS_IRQn);
+}
+
+void disable_event_channel_irq(uint8_t channel) {
+    EVSYS->INTENCLR.reg = channel_interrupts(channel);
+    // Every channel shares one line.
+    if (event_callback_channels() == 0) {
+        NVIC_DisableIRQ(EVSYS_IRQn);
+        NVIC_ClearPendingIRQ(EVSYS_IRQn);
+    }
+}
+
+#if EVSYS_HANDLER
+void EVSYS_Handler(void) {
+    // Channels 0 - 7 and 8 - 11 live in different halves of INTFLAG. Clear everything we handle
+    // with one write.
+    uint32_t channels = event_callback_channels();
+    uint8_t low = channels & 0xff;
+    uint8_t high = channels >> 8;
+    uint32_t mask = EVSYS_INTFLAG_OVR(low) | EVSYS_INTFLAG_EVD(low) |
+                    EVSYS_INTFLAG_OVRp8(high) | EVSYS_INTFLAG_EVDp8(high);
+    uint32_t enabled = EVSYS->INTFLAG.reg & EVSYS->INTENSET.reg;
+    // A channel without a callback would keep the line pending forever. Mask it and leave its
+    // flags for polling.
+    if ((enabled & ~mask) != 0) {
+        EVSYS->INTENCLR.reg = enabled & ~mask;
+    }
+    uint32_t flags = enabled & mask;
+    EVSYS->INTFLAG.reg = flags;
+    uint32_t overflowed = ((flags & EVSYS_INTFLAG_OVR_Msk) >> EVSYS_INTFLAG_OVR_Pos) |
+                          (((flags & EVSYS_INTFLAG_OVRp8_Msk) >> EVSYS_INTFLAG_OVRp8_Pos) << 8);
+    uint32_t detected = ((flags & EVSYS_INTFLAG_EVD_Msk) >> EVSYS_INTFLAG_EVD_Pos) |
+                        (((flags & EVSYS_INTFLAG_EVDp8_Msk) >> EVSYS_INTFLAG_EVDp8_Pos) << 8);
+    event_dispatch(detected, overflowed);
 }
+#endif
 
 bool event_interrupt_active(uint8_t channel) {
     bool active = false;
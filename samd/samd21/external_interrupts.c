@@ -26,20 +26,21 @@
 
 #include "samd/external_interrupts.h"
 
-#include "hpl/gclk/hpl_gclk_base.h"
-#include "samd/clocks.h"
+#include "samd/bus_clocks.h"
+#include "samd/irq_latency.h"
+#include "samd/sync.h"
 #include "sam.h"
 
 void turn_on_external_interrupt_controller(void) {
-    PM->APBAMASK.bit.EIC_ = true;
-    _gclk_enable_channel(EIC_GCLK_ID, GCLK_CLKCTRL_GEN_GCLK0_Val);
+    bus_clock_claim(BUS_APBA, PM_APBAMASK_EIC);
+    gclk_channel_claim(GCLK_CLKCTRL_GEN_GCLK0_Val, EIC_GCLK_ID);
     eic_set_enable(true);
 }
 
 void turn_off_external_interrupt_controller(void) {
     eic_set_enable(false);
-    PM->APBAMASK.bit.EIC_ = false;
-    hri_gclk_write_CLKCTRL_reg(GCLK, GCLK_CLKCTRL_ID(EIC_GCLK_ID));
+    gclk_channel_release(EIC_GCLK_ID);
+    bus_clock_release(BUS_APBA, PM_APBAMASK_EIC);
 }
 
 void turn_on_cpu_interrupt(uint8_t eic_channel) {
@@ -51,21 +52,30 @@ void turn_on_cpu_interrupt(uint8_t eic_channel) {
     NVIC_EnableIRQ(EIC_IRQn);
 }
 
+// There is one shared line so a channel can only go ahead of the others within the handler. It
+// counts as latency critical when asked for a higher priority than the line has.
+void eic_set_channel_priority(uint8_t eic_channel, uint8_t priority) {
+    eic_set_latency_critical(eic_channel, priority < NVIC_GetPriority(EIC_IRQn));
+}
+
 bool eic_get_enable(void) {
     return EIC->CTRL.bit.ENABLE;
 }
 
 void eic_set_enable(bool value) {
+    SYNC_WAIT(EIC->STATUS.bit.SYNCBUSY != 0);
     EIC->CTRL.bit.ENABLE = value;
-    while (EIC->STATUS.bit.SYNCBUSY != 0) {}
+    SYNC_WAIT(EIC->STATUS.bit.SYNCBUSY != 0);
 }
 
 void eic_reset(void) {
     EIC->CTRL.bit.SWRST = true;
-    while (EIC->STATUS.bit.SYNCBUSY != 0) {}
+    SYNC_WAIT(EIC->STATUS.bit.SYNCBUSY != 0);
     for (int i = 0; i < EIC_EXTINT_NUM; i++) {
         set_eic_channel_data(i, NULL);
+        eic_set_callback(i, NULL, NULL);
     }
+    eic_clear_masks();
     NVIC_DisableIRQ(EIC_IRQn);
     NVIC_ClearPendingIRQ(EIC_IRQn);
 }
@@ -74,13 +84,30 @@ bool eic_channel_free(uint8_t eic_channel) {
     uint32_t mask = 1 << eic_channel;
     return get_eic_channel_data(eic_channel) == NULL &&
            (EIC->INTENSET.vec.EXTINT & mask) == 0 &&
+           (eic_masked_channels() & mask) == 0 &&
            (EIC->EVCTRL.vec.EXTINTEO & mask) == 0;
 }
 
+// All channels share one interrupt. Take every pending channel at once and clear them with a
+// single write before dispatching so that an edge arriving during a callback isn't lost. Channels
+// without their interrupt enabled are skipped because event-only channels still set INTFLAG.
 void EIC_Handler(void) {
-    for (uint8_t i = 0; i < 16; i++) {
-        if ((EIC->INTFLAG.vec.EXTINT & (1 << i)) != 0) {
-            external_interrupt_handler(i);
-        }
+    IRQ_LATENCY_ENTRY(entry_cycles);
+    uint32_t pending = EIC->INTFLAG.vec.EXTINT & EIC->INTENSET.vec.EXTINT;
+    EIC->INTFLAG.reg = pending << EIC_INTFLAG_EXTINT_Pos;
+    uint32_t critical = pending & eic_latency_critical_channels();
+    pending &= ~critical;
+    while (critical != 0) {
+        uint8_t channel = __builtin_ctz(critical);
+        critical &= critical - 1;
+        IRQ_LATENCY_RECORD(IRQ_LATENCY_EIC_CRITICAL, entry_cycles);
+        eic_dispatch(channel);
+    }
+    while (pending != 0) {
+        uint8_t channel = __builtin_ctz(pending);
+        pending &= pending - 1;
+        IRQ_LATENCY_RECORD(IRQ_LATENCY_EIC, entry_cycles);
+        eic_dispatch(channel);
     }
+    IRQ_LATENCY_EXIT(IRQ_LATENCY_EIC, entry_cycles);
 }
@@ -26,21 +26,36 @@
 
 #include "samd/i2s.h"
 
+#include "samd/bus_clocks.h"
 #include "samd/clocks.h"
+#include "samd/sync.h"
 
 #include "hpl/gclk/hpl_gclk_base.h"
-#include "hpl/pm/hpl_pm_base.h"
+
+static bool i2s_on;
 
 void turn_on_i2s(void) {
-    _pm_enable_bus_clock(PM_BUS_APBC, I2S);
+    if (i2s_on) {
+        return;
+    }
+    bus_clock_claim(BUS_APBC, PM_APBCMASK_I2S);
+    i2s_on = true;
+}
+
+void turn_off_i2s(void) {
+    if (!i2s_on) {
+        return;
+    }
+    bus_clock_release(BUS_APBC, PM_APBCMASK_I2S);
+    i2s_on = false;
 }
 
 void i2s_set_serializer_enable(uint8_t serializer, bool enable) {
-    while ((I2S->SYNCBUSY.vec.SEREN & (1 << serializer)) != 0) {}
+    SYNC_WAIT((I2S->SYNCBUSY.vec.SEREN & (1 << serializer)) != 0);
     if (enable) {
         I2S->CTRLA.vec.SEREN = 1 << serializer;
     } else {
         I2S->CTRLA.vec.SEREN &= ~(1 << serializer);
     }
-    while ((I2S->SYNCBUSY.vec.SEREN & (1 << serializer)) != 0) {}
+    SYNC_WAIT((I2S->SYNCBUSY.vec.SEREN & (1 << serializer)) != 0);
 }
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/quadrature.h"
+
+#include "samd/events.h"
+#include "samd/external_interrupts.h"
+#include "samd/sync.h"
+#include "samd/timers.h"
+
+#include "sam.h"
+
+uint32_t quadrature_hardware_count(quadrature_t* self) {
+    Tcc* tcc = tcc_insts[self->timer_index];
+    tcc->CTRLBSET.reg = TCC_CTRLBSET_CMD_READSYNC;
+    SYNC_WAIT(tcc->SYNCBUSY.bit.CTRLB != 0 || tcc->CTRLBSET.bit.CMD != 0);
+    SYNC_WAIT(tcc->SYNCBUSY.bit.COUNT != 0);
+    return tcc->COUNT.reg & self->count_mask;
+}
+
+bool quadrature_hardware_start(quadrature_t* self, uint8_t eic_channel_a, uint8_t eic_channel_b,
+                               uint8_t timer_index, uint8_t gclk, bool reverse) {
+    if (timer_index >= TCC_INST_NUM || eic_channel_a == eic_channel_b ||
+        !eic_channel_free(eic_channel_a) || !eic_channel_free(eic_channel_b)) {
+        return false;
+    }
+    Tcc* tcc = tcc_insts[timer_index];
+    if (tcc->CTRLA.bit.ENABLE == 1) {
+        return false;
+    }
+
+    // The TCC ignores events until it's enabled below. Level sensing makes the direction event
+    // follow phase B.
+    uint8_t user = tcc_event_user_ids[timer_index];
+    uint8_t event_channel_a = turn_on_eic_event_channel(eic_channel_a, EIC_CONFIG_SENSE0_RISE_Val,
+                                                        user, self);
+    if (event_channel_a >= EVSYS_CHANNELS) {
+        return false;
+    }
+    uint8_t event_channel_b = turn_on_eic_event_channel(eic_channel_b, EIC_CONFIG_SENSE0_HIGH_Val,
+                                                        user + 1, self);
+    if (event_channel_b >= EVSYS_CHANNELS) {
+        turn_off_eic_channel(eic_channel_a);
+        return false;
+    }
+
+    self->timer_index = timer_index;
+    self->eic_channel_a = eic_channel_a;
+    self->eic_channel_b = eic_channel_b;
+    self->event_channel_a = event_channel_a;
+    self->event_channel_b = event_channel_b;
+    self->count_mask = (1UL << tcc_counter_bits[timer_index]) - 1;
+
+    // The TCC counts one step for every count event and the level of the direction event picks
+    // which way. Phase B is low on the rising edge of phase A when A leads so that counts up.
+    if (!timer_claim_clocks(false, timer_index, gclk)) {
+        turn_off_eic_channel(eic_channel_a);
+        turn_off_eic_channel(eic_channel_b);
+        return false;
+    }
+    tcc_reset(tcc);
+    tcc->PER.reg = self->count_mask;
+    uint32_t evctrl = TCC_EVCTRL_TCEI0 | TCC_EVCTRL_EVACT0_COUNTEV |
+                      TCC_EVCTRL_TCEI1 | TCC_EVCTRL_EVACT1_DIR;
+    if (reverse) {
+        evctrl |= TCC_EVCTRL_TCINV1;
+    }
+    tcc->EVCTRL.reg = evctrl;
+    SYNC_WAIT(tcc->SYNCBUSY.reg != 0);
+    tcc_set_enable(tcc, true);
+    return true;
+}
+
+void quadrature_hardware_stop(quadrature_t* self) {
+    turn_off_eic_channel(self->eic_channel_a);
+    turn_off_eic_channel(self->eic_channel_b);
+
+    Tcc* tcc = tcc_insts[self->timer_index];
+    tcc_set_enable(tcc, false);
+    tcc_reset(tcc);
+    timer_release_clocks(false, self->timer_index);
+}
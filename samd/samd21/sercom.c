@@ -24,8 +24,8 @@
  * THE SOFTWARE.
  */
 
-#include "hpl/gclk/hpl_gclk_base.h"
-#include "hpl/pm/hpl_pm_base.h"
+#include "samd/bus_clocks.h"
+#include "samd/sercom.h"
 
 // The clock initializer values are rather random, so we need to put them in
 // tables for lookup. We can't compute them.
@@ -60,9 +60,18 @@ Sercom* sercom_insts[SERCOM_INST_NUM] = SERCOM_INSTS;
 
 // Clock initialization as done in Atmel START.
 void samd_peripherals_sercom_clock_init(Sercom* sercom, uint8_t sercom_index) {
-    _pm_enable_bus_clock(PM_BUS_APBC, sercom);
-    _gclk_enable_channel(SERCOMx_GCLK_ID_CORE[sercom_index], GCLK_CLKCTRL_GEN_GCLK0_Val);
-    _gclk_enable_channel(SERCOMx_GCLK_ID_SLOW[sercom_index], GCLK_CLKCTRL_GEN_GCLK3_Val);
+    (void) sercom;
+    bus_clock_claim(BUS_APBC, PM_APBCMASK_SERCOM0 << sercom_index);
+    gclk_channel_claim(GCLK_CLKCTRL_GEN_GCLK0_Val, SERCOMx_GCLK_ID_CORE[sercom_index]);
+    // Every SERCOM shares the slow channel.
+    gclk_channel_claim(GCLK_CLKCTRL_GEN_GCLK3_Val, SERCOMx_GCLK_ID_SLOW[sercom_index]);
+}
+
+void samd_peripherals_sercom_clock_deinit(Sercom* sercom, uint8_t sercom_index) {
+    (void) sercom;
+    gclk_channel_release(SERCOMx_GCLK_ID_SLOW[sercom_index]);
+    gclk_channel_release(SERCOMx_GCLK_ID_CORE[sercom_index]);
+    bus_clock_release(BUS_APBC, PM_APBCMASK_SERCOM0 << sercom_index);
 }
 
 // Figure out the DOPO value given the chosen clock pad and mosi pad.
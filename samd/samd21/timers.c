@@ -27,13 +27,15 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "samd/bus_clocks.h"
+#include "samd/clocks.h"
+#include "samd/sync.h"
 #include "samd/timers.h"
 
 #include "timer_handler.h"
 
-#include "hpl/gclk/hpl_gclk_base.h"
-
 const uint8_t tcc_cc_num[3] = {4, 2, 2};
+const uint8_t tcc_counter_bits[3] = {24, 24, 16};
 const uint8_t tc_gclk_ids[TC_INST_NUM] = {TC3_GCLK_ID,
                TC4_GCLK_ID,
                TC5_GCLK_ID,
@@ -44,32 +46,121 @@ const uint8_t tc_gclk_ids[TC_INST_NUM] = {TC3_GCLK_ID,
                TC7_GCLK_ID,
 #endif
             };
+const uint8_t tc_ovf_dmac_ids[TC_INST_NUM] = {TC3_DMAC_ID_OVF,
+               TC4_DMAC_ID_OVF,
+               TC5_DMAC_ID_OVF,
+#ifdef TC6_DMAC_ID_OVF
+               TC6_DMAC_ID_OVF,
+#endif
+#ifdef TC7_DMAC_ID_OVF
+               TC7_DMAC_ID_OVF,
+#endif
+            };
+const uint8_t tc_event_user_ids[TC_INST_NUM] = {EVSYS_ID_USER_TC3_EVU,
+               EVSYS_ID_USER_TC4_EVU,
+               EVSYS_ID_USER_TC5_EVU,
+#ifdef EVSYS_ID_USER_TC6_EVU
+               EVSYS_ID_USER_TC6_EVU,
+#endif
+#ifdef EVSYS_ID_USER_TC7_EVU
+               EVSYS_ID_USER_TC7_EVU,
+#endif
+            };
 const uint8_t tcc_gclk_ids[3] = {TCC0_GCLK_ID, TCC1_GCLK_ID, TCC2_GCLK_ID};
+const uint8_t tcc_ovf_dmac_ids[TCC_INST_NUM] = {TCC0_DMAC_ID_OVF, TCC1_DMAC_ID_OVF, TCC2_DMAC_ID_OVF};
+const uint8_t tcc_event_user_ids[TCC_INST_NUM] = {EVSYS_ID_USER_TCC0_EV_0,
+                                                 EVSYS_ID_USER_TCC1_EV_0,
+                                                 EVSYS_ID_USER_TCC2_EV_0};
 
-void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
-    uint8_t gclk_id;
-    if (is_tc) {
-        gclk_id = tc_gclk_ids[index];
-    } else {
-        gclk_id = tcc_gclk_ids[index];
-    }
-    // Determine the clock slot on the APBC bus. TCC0 is the first and 8 slots in.
+// Determine the clock slot on the APBC bus. TCC0 is the first and 8 slots in.
+static uint32_t timer_apbc_mask(bool is_tc, uint8_t index) {
     uint8_t clock_slot = 8 + index;
     // We index TCs starting at zero but in memory they begin at three so we have to add three.
     if (is_tc) {
         clock_slot += 3;
     }
-    PM->APBCMASK.reg |= 1 << clock_slot;
-    _gclk_enable_channel(gclk_id, gclk_index);
+    return 1 << clock_slot;
+}
+
+void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
+    bus_clock_pin(BUS_APBC, timer_apbc_mask(is_tc, index));
+    gclk_channel_connect(gclk_index, is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index]);
+}
+
+bool timer_claim_clocks(bool is_tc, uint8_t index, uint32_t gclk_index) {
+    if (!gclk_channel_claim(gclk_index, is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index])) {
+        return false;
+    }
+    bus_clock_claim(BUS_APBC, timer_apbc_mask(is_tc, index));
+    return true;
+}
+
+void timer_release_clocks(bool is_tc, uint8_t index) {
+    gclk_channel_release(is_tc ? tc_gclk_ids[index] : tcc_gclk_ids[index]);
+    bus_clock_release(BUS_APBC, timer_apbc_mask(is_tc, index));
 }
 
 void tc_set_enable(Tc* tc, bool enable) {
+    tc_wait_for_sync(tc);
     tc->COUNT16.CTRLA.bit.ENABLE = enable;
-    while (tc->COUNT16.STATUS.bit.SYNCBUSY != 0) {
-        /* Wait for sync */
-    }
+    // Enable-protected registers can only change once a disable has synchronized, and callers
+    // expect the timer to be counting once an enable returns.
+    tc_wait_for_sync(tc);
 }
 
 void tc_wait_for_sync(Tc* tc) {
-    while (tc->COUNT16.STATUS.bit.SYNCBUSY != 0) {}
+    SYNC_WAIT(tc->COUNT16.STATUS.bit.SYNCBUSY != 0);
+}
+
+// Set up a disabled TC to overflow at the period found by timer_solve_period().
+void tc_configure_period(Tc* tc, const timer_period_t* period) {
+    uint32_t prescaler_setting = TC_CTRLA_PRESCALER(period->prescaler_index);
+    if (period->counter_bits == 8) {
+        tc->COUNT8.CTRLA.reg = TC_CTRLA_MODE_COUNT8 | TC_CTRLA_WAVEGEN_NFRQ | prescaler_setting;
+        tc->COUNT8.PER.reg = period->top;
+    } else if (period->counter_bits == 16) {
+        tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | prescaler_setting;
+        tc->COUNT16.CC[0].reg = period->top;
+    } else {
+        tc->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_WAVEGEN_MFRQ | prescaler_setting;
+        tc->COUNT32.CC[0].reg = period->top;
+    }
+    tc_wait_for_sync(tc);
+}
+
+// Set up a disabled TC as a 16-bit counter that captures into both channels on its event input.
+void tc_configure_capture(Tc* tc, uint8_t prescaler_index, uint8_t event_action, bool invert_event) {
+    tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER(prescaler_index);
+    tc->COUNT16.CTRLC.reg = TC_CTRLC_CPTEN0 | TC_CTRLC_CPTEN1;
+    uint16_t invert = 0;
+    if (invert_event) {
+        invert = TC_EVCTRL_TCINV;
+    }
+    tc->COUNT16.EVCTRL.reg = TC_EVCTRL_TCEI | TC_EVCTRL_EVACT(event_action) | invert;
+    tc_wait_for_sync(tc);
+}
+
+// Keep COUNT synchronized in the background so that reads don't need to request and wait for it.
+void tc_enable_continuous_read(Tc* tc) {
+    tc->COUNT32.READREQ.reg = TC_READREQ_RCONT | TC_READREQ_ADDR(TC_COUNT32_COUNT_OFFSET);
+}
+
+// The first read turns on continuous reads and waits for COUNT once. Later reads don't wait at all
+// until a reset clears RCONT.
+uint16_t tc_read_count16(Tc* tc) {
+    if (tc->COUNT16.READREQ.bit.RCONT == 0) {
+        tc->COUNT16.READREQ.reg = TC_READREQ_RCONT | TC_READREQ_RREQ |
+                                  TC_READREQ_ADDR(TC_COUNT16_COUNT_OFFSET);
+        tc_wait_for_sync(tc);
+    }
+    return tc->COUNT16.COUNT.reg;
+}
+
+uint32_t tc_read_count32(Tc* tc) {
+    if (tc->COUNT32.READREQ.bit.RCONT == 0) {
+        tc->COUNT32.READREQ.reg = TC_READREQ_RCONT | TC_READREQ_RREQ |
+                                  TC_READREQ_ADDR(TC_COUNT32_COUNT_OFFSET);
+        tc_wait_for_sync(tc);
+    }
+    return tc->COUNT32.COUNT.reg;
 }
@@ -33,6 +33,8 @@
 #include "sam.h"
 
 void samd_peripherals_sercom_clock_init(Sercom* sercom, uint8_t sercom_index);
+// Gates the SERCOM's clocks again once it has been reset.
+void samd_peripherals_sercom_clock_deinit(Sercom* sercom, uint8_t sercom_index);
 uint8_t samd_peripherals_get_spi_dopo(uint8_t clock_pad, uint8_t mosi_pad);
 uint8_t samd_peripherals_spi_baudrate_to_baud_reg_value(const uint32_t baudrate);
 uint32_t samd_peripherals_spi_baud_reg_value_to_baudrate(const uint8_t baud_reg_value);
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/sync.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+#include "sam.h"
+
+uint32_t sync_cycle_count(void) {
+    #ifdef SAM_D5X_E5X
+    return DWT->CYCCNT;
+    #endif
+    #ifdef SAMD21
+    // SysTick counts down so flip it to count up like CYCCNT.
+    return SysTick->LOAD - SysTick->VAL;
+    #endif
+}
+
+#if SYNC_WAIT_STATS
+static volatile uint32_t sync_waits;
+static volatile uint64_t sync_cycles;
+
+void sync_record_wait(uint32_t start) {
+    uint32_t now = sync_cycle_count();
+    #ifdef SAMD21
+    // SysTick wrapped during the wait.
+    if (now < start) {
+        now += SysTick->LOAD + 1;
+    }
+    #endif
+    uint32_t elapsed = now - start;
+    common_hal_mcu_disable_interrupts();
+    sync_waits++;
+    sync_cycles += elapsed;
+    common_hal_mcu_enable_interrupts();
+}
+#endif
+
+void sync_stats_reset(void) {
+    #if SYNC_WAIT_STATS
+    #ifdef SAM_D5X_E5X
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+    common_hal_mcu_disable_interrupts();
+    sync_waits = 0;
+    sync_cycles = 0;
+    common_hal_mcu_enable_interrupts();
+    #endif
+}
+
+void sync_get_stats(sync_stats_t* stats) {
+    #if SYNC_WAIT_STATS
+    common_hal_mcu_disable_interrupts();
+    stats->waits = sync_waits;
+    stats->cycles = sync_cycles;
+    common_hal_mcu_enable_interrupts();
+    #else
+    stats->waits = 0;
+    stats->cycles = 0;
+    #endif
+}
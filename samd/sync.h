@@ -0,0 +1,76 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_SYNC_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_SYNC_H
+
+#include <stdint.h>
+
+#include "samd_peripherals_config.h"
+
+// Register synchronization between the CPU and peripheral clock domains. The helpers in this
+// library wait before a write when an earlier write may still be synchronizing. Enables and
+// disables also wait afterwards so the peripheral is running, or its enable-protected registers
+// are writable, by the time they return. Reads that need a synchronized value still wait. Code that
+// sets up several peripherals together batches them by writing to all of them before waiting on
+// any, as timer_start_group() does, so their delays overlap.
+
+#ifndef SYNC_WAIT_STATS
+#define SYNC_WAIT_STATS 0
+#endif
+
+typedef struct {
+    uint32_t waits;  // Waits that actually had to spin.
+    uint64_t cycles; // CPU cycles spent spinning.
+} sync_stats_t;
+
+// CPU cycles from the counters described below. Also used by irq_latency.h.
+uint32_t sync_cycle_count(void);
+
+#if SYNC_WAIT_STATS
+void sync_record_wait(uint32_t start);
+
+#define SYNC_WAIT(busy) \
+    do { \
+        if (busy) { \
+            uint32_t sync_start = sync_cycle_count(); \
+            while (busy) {} \
+            sync_record_wait(sync_start); \
+        } \
+    } while (0)
+#else
+#define SYNC_WAIT(busy) \
+    do { \
+        while (busy) {} \
+    } while (0)
+#endif
+
+// Cycles are counted with the DWT cycle counter on the SAM_D5X_E5X and with SysTick on the SAMD21.
+// SysTick only counts while it's running and a wait longer than its period is undercounted.
+void sync_stats_reset(void);
+void sync_get_stats(sync_stats_t* stats);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_SYNC_H
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "samd/tcc_dma.h"
+
+#include <stddef.h>
+
+#include "samd/dma.h"
+#include "samd/timers.h"
+
+static volatile uint32_t* tcc_ccbuf(Tcc* tcc, uint8_t cc) {
+    #ifdef SAMD21
+    return &tcc->CCB[cc].reg;
+    #endif
+    #ifdef SAM_D5X_E5X
+    return &tcc->CCBUF[cc].reg;
+    #endif
+}
+
+static void init_descriptor(DmacDescriptor* descriptor, uint32_t* source, uint32_t beats,
+                            volatile uint32_t* destination, DmacDescriptor* next, bool interrupt) {
+    descriptor->BTCTRL.reg = DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC;
+    if (interrupt) {
+        descriptor->BTCTRL.reg |= DMAC_BTCTRL_BLOCKACT_INT;
+    }
+    descriptor->BTCNT.reg = beats;
+    // Incrementing addresses point at the end of the block.
+    descriptor->SRCADDR.reg = (uint32_t) (source + beats);
+    descriptor->DSTADDR.reg = (uint32_t) destination;
+    descriptor->DESCADDR.reg = (uint32_t) next;
+    descriptor->BTCTRL.bit.VALID = true;
+}
+
+bool tcc_dma_stream_start(tcc_dma_stream_t* stream, uint8_t dma_channel, uint8_t tcc_index,
+                          uint8_t cc, uint32_t* buffer, uint32_t length, bool ping_pong) {
+    if (dma_channel >= DMA_CHANNEL_COUNT || !dma_channel_free(dma_channel) ||
+        tcc_index >= TCC_INST_NUM || cc >= tcc_cc_num[tcc_index] || length == 0 || (ping_pong && length % 2 != 0)) {
+        return false;
+    }
+    stream->buffer = buffer;
+    stream->length = length;
+    stream->dma_channel = dma_channel;
+    stream->tcc_index = tcc_index;
+    stream->cc = cc;
+    stream->ping_pong = ping_pong;
+    // The first half finishes first.
+    stream->last_half = 1;
+    stream->underruns = 0;
+
+    dma_configure(dma_channel, tcc_ovf_dmac_ids[tcc_index], false);
+    volatile uint32_t* destination = tcc_ccbuf(tcc_insts[tcc_index], cc);
+    DmacDescriptor* first = dma_descriptor(dma_channel);
+    if (ping_pong) {
+        uint32_t half = length / 2;
+        init_descriptor(first, buffer, half, destination, &stream->second_descriptor, true);
+        init_descriptor(&stream->second_descriptor, buffer + half, half, destination, first, true);
+    } else {
+        init_descriptor(first, buffer, length, destination, first, false);
+    }
+    dma_enable_channel(dma_channel);
+    return true;
+}
+
+void tcc_dma_stream_stop(tcc_dma_stream_t* stream) {
+    dma_disable_channel(stream->dma_channel);
+    dma_descriptor(stream->dma_channel)->BTCTRL.bit.VALID = false;
+    stream->second_descriptor.BTCTRL.bit.VALID = false;
+}
+
+uint32_t* tcc_dma_stream_free_half(tcc_dma_stream_t* stream) {
+    if (!stream->ping_pong ||
+        (dma_transfer_status(stream->dma_channel) & DMAC_CHINTFLAG_TCMPL) == 0) {
+        return NULL;
+    }
+    dma_clear_transfer_status(stream->dma_channel, DMAC_CHINTFLAG_TCMPL);
+    // TCMPL is sticky so it can't say how many halves finished. The write back descriptor is the
+    // one in progress and it links to the free one. Finding the same free half as last time means
+    // the other half finished too and was never handed back for a refill.
+    DmacDescriptor* in_progress = dma_write_back_descriptor(stream->dma_channel);
+    uint8_t half = in_progress->DESCADDR.reg == (uint32_t) &stream->second_descriptor ? 1 : 0;
+    if (half == stream->last_half) {
+        stream->underruns++;
+    }
+    stream->last_half = half;
+    return stream->buffer + half * (stream->length / 2);
+}
+
+uint32_t tcc_dma_stream_underruns(tcc_dma_stream_t* stream) {
+    return stream->underruns;
+}
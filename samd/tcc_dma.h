@@ -0,0 +1,68 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_TCC_DMA_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_TCC_DMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+#include "hal/utils/include/utils.h"
+
+// Streams a buffer of compare values into a TCC's CCBUF, one per overflow, with DMA. Values take
+// effect on the following update so every period gets exactly one value without a CPU interrupt.
+typedef struct {
+    // Only used for ping-pong. The channel's own descriptor covers the first half.
+    COMPILER_ALIGNED(16) DmacDescriptor second_descriptor;
+    uint32_t* buffer;
+    uint32_t length;
+    uint8_t dma_channel;
+    uint8_t tcc_index;
+    uint8_t cc;
+    bool ping_pong;
+    // Ping-pong bookkeeping. The half last handed back and how many halves replayed stale data.
+    uint8_t last_half;
+    uint32_t underruns;
+} tcc_dma_stream_t;
+
+// The TCC should already be configured and running. In circular mode the whole buffer repeats.
+// In ping-pong mode each half is refilled by the caller once tcc_dma_stream_free_half() hands it
+// back.
+bool tcc_dma_stream_start(tcc_dma_stream_t* stream, uint8_t dma_channel, uint8_t tcc_index,
+                          uint8_t cc, uint32_t* buffer, uint32_t length, bool ping_pong);
+void tcc_dma_stream_stop(tcc_dma_stream_t* stream);
+// Returns the half of the buffer that has finished playing or NULL if neither has since last call.
+// Halves always come back in alternating order unless both finished since the last call. Then the
+// half that was never refilled played its old values again, the same half is handed back twice and
+// the underrun count goes up.
+uint32_t* tcc_dma_stream_free_half(tcc_dma_stream_t* stream);
+// Without a DMA interrupt an even number of missed halves can't be told from none so this is a
+// lower bound.
+uint32_t tcc_dma_stream_underruns(tcc_dma_stream_t* stream);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_PERIPHERALS_TCC_DMA_H
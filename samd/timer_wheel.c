@@ -0,0 +1,275 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "samd/timer_wheel.h"
+
+#include "samd/timestamp.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+#define SLOT_BITS 6
+#define SLOT_COUNT (1 << SLOT_BITS)
+#define SLOT_MASK (SLOT_COUNT - 1)
+
+#define TICK_ROUND ((1ULL << TIMER_WHEEL_TICK_SHIFT) - 1)
+#define NO_EVENT UINT64_MAX
+
+// Keep alarms well inside the 32-bit compare range so they can't alias.
+#define MAX_ALARM_DELAY 0x80000000ULL
+
+static timer_wheel_timer_t* slots[TIMER_WHEEL_LEVELS][SLOT_COUNT];
+static uint64_t occupied[TIMER_WHEEL_LEVELS];
+
+// The first wheel tick that hasn't been run yet.
+static uint64_t wheel_now;
+// The wheel tick the alarm is set for.
+static uint64_t scheduled_tick;
+static bool wheel_running = false;
+
+static void enqueue(timer_wheel_timer_t* timer) {
+    uint64_t expires = timer->expires;
+    if (expires < wheel_now) {
+        expires = wheel_now;
+    }
+    uint64_t delta = expires - wheel_now;
+    uint8_t level = 0;
+    if (delta >= SLOT_COUNT) {
+        level = (63 - __builtin_clzll(delta)) / SLOT_BITS;
+        if (level >= TIMER_WHEEL_LEVELS) {
+            // Park it in the furthest slot. It'll be re-enqueued when it gets to the bottom.
+            level = TIMER_WHEEL_LEVELS - 1;
+            expires = wheel_now + (1ULL << (SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+        }
+    }
+    uint8_t slot = (expires >> (SLOT_BITS * level)) & SLOT_MASK;
+
+    timer_wheel_timer_t** head = &slots[level][slot];
+    timer->next = *head;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+    timer->level = level;
+    timer->slot = slot;
+    occupied[level] |= 1ULL << slot;
+}
+
+static void unlink(timer_wheel_timer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+    if (slots[timer->level][timer->slot] == NULL) {
+        occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+}
+
+// Move a slot's timers onto a local list so that callbacks can still cancel any of them.
+static void detach_slot(uint8_t level, uint8_t slot, timer_wheel_timer_t** list) {
+    *list = slots[level][slot];
+    if (*list != NULL) {
+        (*list)->pprev = list;
+    }
+    slots[level][slot] = NULL;
+    occupied[level] &= ~(1ULL << slot);
+}
+
+// Returns the first wheel tick at or after wheel_now where a timer expires or a slot cascades.
+static uint64_t next_event(void) {
+    uint64_t next = NO_EVENT;
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (occupied[level] == 0) {
+            continue;
+        }
+        uint8_t shift = SLOT_BITS * level;
+        // Slots above level zero are handled on the boundary where their index comes up.
+        uint64_t base = (wheel_now + (1ULL << shift) - 1) >> shift;
+        uint8_t start = base & SLOT_MASK;
+        uint64_t rotated = (occupied[level] >> start) | (occupied[level] << ((SLOT_COUNT - start) & SLOT_MASK));
+        uint64_t tick = (base + __builtin_ctzll(rotated)) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+static void cascade(uint64_t tick) {
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        uint8_t shift = SLOT_BITS * level;
+        if ((tick & ((1ULL << shift) - 1)) != 0) {
+            break;
+        }
+        timer_wheel_timer_t* list;
+        detach_slot(level, (tick >> shift) & SLOT_MASK, &list);
+        while (list != NULL) {
+            timer_wheel_timer_t* timer = list;
+            unlink(timer);
+            enqueue(timer);
+        }
+    }
+}
+
+static void run_until(uint64_t target) {
+    while (true) {
+        uint64_t tick = next_event();
+        if (tick > target) {
+            break;
+        }
+        // Nothing happens between wheel_now and tick so we can skip straight there.
+        wheel_now = tick;
+        cascade(tick);
+
+        timer_wheel_timer_t* expired;
+        detach_slot(0, tick & SLOT_MASK, &expired);
+        // Timers (re)started from callbacks go no earlier than the next tick.
+        wheel_now = tick + 1;
+        while (expired != NULL) {
+            timer_wheel_timer_t* timer = expired;
+            unlink(timer);
+            if (timer->expires > tick) {
+                // A parked timer that isn't due yet.
+                enqueue(timer);
+                continue;
+            }
+            // Requeue before the callback so that it can cancel or restart the timer.
+            if (timer->period != 0) {
+                timer->expires += timer->period;
+                enqueue(timer);
+            }
+            timer->callback(timer->context);
+        }
+    }
+    if (wheel_now <= target) {
+        wheel_now = target + 1;
+    }
+}
+
+static void schedule(void) {
+    uint64_t tick = next_event();
+    scheduled_tick = tick;
+    if (tick == NO_EVENT) {
+        timestamp_clear_alarm();
+        return;
+    }
+    uint64_t deadline = tick << TIMER_WHEEL_TICK_SHIFT;
+    uint64_t now = timestamp_ticks();
+    if (deadline > now + MAX_ALARM_DELAY) {
+        deadline = now + MAX_ALARM_DELAY;
+    }
+    if (deadline > now && timestamp_set_alarm(deadline)) {
+        return;
+    }
+    // Already due. Callbacks only ever run from the alarm interrupt, never from
+    // timer_wheel_start(), so hand it over rather than running them here.
+    timestamp_pend_alarm();
+}
+
+static void timer_wheel_alarm(void) {
+    run_until(timestamp_ticks() >> TIMER_WHEEL_TICK_SHIFT);
+    schedule();
+}
+
+bool timer_wheel_init(void) {
+    if (!timestamp_enabled()) {
+        return false;
+    }
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+            slots[level][slot] = NULL;
+        }
+        occupied[level] = 0;
+    }
+    wheel_now = timestamp_ticks() >> TIMER_WHEEL_TICK_SHIFT;
+    scheduled_tick = NO_EVENT;
+    timestamp_set_alarm_callback(timer_wheel_alarm);
+    wheel_running = true;
+    return true;
+}
+
+void timer_wheel_deinit(void) {
+    if (!wheel_running) {
+        return;
+    }
+    common_hal_mcu_disable_interrupts();
+    timestamp_clear_alarm();
+    timestamp_set_alarm_callback(NULL);
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+            while (slots[level][slot] != NULL) {
+                unlink(slots[level][slot]);
+            }
+        }
+    }
+    wheel_running = false;
+    common_hal_mcu_enable_interrupts();
+}
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, void (*callback)(void* context), void* context) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->period = 0;
+    timer->callback = callback;
+    timer->context = context;
+}
+
+void timer_wheel_start(timer_wheel_timer_t* timer, uint64_t delay, uint32_t period) {
+    common_hal_mcu_disable_interrupts();
+    if (timer->pprev != NULL) {
+        unlink(timer);
+    }
+    timer->expires = (timestamp_ticks() + delay + TICK_ROUND) >> TIMER_WHEEL_TICK_SHIFT;
+    timer->period = 0;
+    if (period != 0) {
+        timer->period = (period + TICK_ROUND) >> TIMER_WHEEL_TICK_SHIFT;
+    }
+    enqueue(timer);
+    // Cancelled timers leave the alarm as is so it only needs to move earlier.
+    if (timer->expires < scheduled_tick) {
+        schedule();
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+void timer_wheel_cancel(timer_wheel_timer_t* timer) {
+    common_hal_mcu_disable_interrupts();
+    if (timer->pprev != NULL) {
+        unlink(timer);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+bool timer_wheel_active(const timer_wheel_timer_t* timer) {
+    return timer->pprev != NULL;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_TIMER_WHEEL_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "samd_peripherals_config.h"
+
+// Many software timers multiplexed onto the timestamp TC's compare alarm. Timers live in a
+// hierarchical wheel so starting and cancelling are constant time and the alarm is only
+// programmed for the next tick where something happens.
+
+// Wheel ticks are 2^TIMER_WHEEL_TICK_SHIFT timestamp ticks long. Deadlines are rounded up to them.
+#ifndef TIMER_WHEEL_TICK_SHIFT
+#define TIMER_WHEEL_TICK_SHIFT 10
+#endif
+
+// Each level has 64 slots. Timers further out than the last level are parked and re-inserted.
+#ifndef TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_LEVELS 4
+#endif
+
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer* next;
+    struct timer_wheel_timer** pprev;  // NULL when the timer isn't running.
+    uint64_t expires;                  // In wheel ticks.
+    uint32_t period;                   // In wheel ticks. Zero for one shot timers.
+    uint8_t level;
+    uint8_t slot;
+    void (*callback)(void* context);
+    void* context;
+} timer_wheel_timer_t;
+
+// The timestamp service must already be running.
+bool timer_wheel_init(void);
+void timer_wheel_deinit(void);
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, void (*callback)(void* context), void* context);
+// Delay and period are in timestamp ticks. Callbacks run from the timer interrupt. Starting a
+// running timer restarts it.
+void timer_wheel_start(timer_wheel_timer_t* timer, uint64_t delay, uint32_t period);
+void timer_wheel_cancel(timer_wheel_timer_t* timer);
+bool timer_wheel_active(const timer_wheel_timer_t* timer);
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_TIMER_WHEEL_H
@@ -25,15 +25,32 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "timers.h"
 
+#include "clocks.h"
+#include "events.h"
+#include "irq_latency.h"
+#include "sync.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
 const uint16_t prescaler[8] = {1, 2, 4, 8, 16, 64, 256, 1024};
 
 Tc* const tc_insts[TC_INST_NUM] = TC_INSTS;
 Tcc* const tcc_insts[TCC_INST_NUM] = TCC_INSTS;
 
+typedef struct {
+    void (*callback)(void* context);
+    void* context;
+} timer_callback_t;
+
+// Handlers call straight into these when set. Otherwise they fall back to shared_timer_handler().
+static timer_callback_t tc_callbacks[TC_INST_NUM];
+static timer_callback_t tcc_callbacks[TCC_INST_NUM];
+
 IRQn_Type const tc_irq[TC_INST_NUM] = {
 #ifdef TC0
     TC0_IRQn,
@@ -71,6 +88,91 @@ uint8_t find_free_timer(void) {
     return 0xff;
 }
 
+// Search prescalers, counter widths and (optionally) an extra generator divisor for the settings
+// closest to the requested frequency with at least resolution steps per period. Everything is
+// 32-bit integer math so it's cheap enough to run on every frequency change. Searching generator
+// divisors multiplies the work so pass 1 to only use the clock that is already connected. Pass 0
+// for max_counter_bits to allow any counter width.
+bool timer_solve_period(bool is_tc, uint8_t index, uint32_t frequency, uint32_t resolution,
+                        uint16_t max_gclk_divisor, uint8_t max_counter_bits, timer_period_t* result) {
+    uint32_t input_frequency;
+    uint8_t widths[3];
+    uint8_t width_count = 0;
+    if (is_tc) {
+        input_frequency = clock_get_frequency(1, tc_gclk_ids[index]);
+        widths[width_count++] = 8;
+        widths[width_count++] = 16;
+        // 32-bit mode pairs an even-numbered TC with the next one.
+        if ((index + TC_OFFSET) % 2 == 0 && index + 1 < TC_INST_NUM &&
+            (max_counter_bits == 0 || max_counter_bits >= 32)) {
+            widths[width_count++] = 32;
+        }
+    } else {
+        input_frequency = clock_get_frequency(1, tcc_gclk_ids[index]);
+        widths[width_count++] = tcc_counter_bits[index];
+    }
+    if (frequency == 0 || input_frequency == 0 || frequency > input_frequency) {
+        return false;
+    }
+    if (resolution == 0) {
+        resolution = 1;
+    }
+    if (max_gclk_divisor == 0) {
+        max_gclk_divisor = 1;
+    }
+
+    bool found = false;
+    uint32_t best_error = 0;
+    uint32_t best_counts = 1;
+    for (uint8_t w = 0; w < width_count; w++) {
+        if (max_counter_bits != 0 && widths[w] > max_counter_bits) {
+            continue;
+        }
+        uint64_t max_steps = 1ULL << widths[w];
+        for (uint8_t p = 0; p < 8; p++) {
+            // Frequency can't be reached with this or any larger prescaler.
+            if (frequency > input_frequency / prescaler[p]) {
+                break;
+            }
+            for (uint32_t divisor = 1; divisor <= max_gclk_divisor; divisor++) {
+                uint32_t scale = prescaler[p] * divisor;
+                if (frequency > input_frequency / scale) {
+                    break;
+                }
+                // scale * frequency <= input_frequency so none of this overflows.
+                uint32_t step_frequency = scale * frequency;
+                uint32_t steps = (input_frequency + step_frequency / 2) / step_frequency;
+                if (steps < resolution) {
+                    break;
+                }
+                if (steps > max_steps) {
+                    continue;
+                }
+                uint32_t counts = scale * steps;
+                uint32_t error = counts * frequency > input_frequency ?
+                                 counts * frequency - input_frequency :
+                                 input_frequency - counts * frequency;
+                // The frequency error is error / counts. Ties go to the finer setting with the
+                // larger top, which may be in a wider counter that's searched later.
+                uint64_t weighted_error = (uint64_t) error * best_counts;
+                uint64_t weighted_best = (uint64_t) best_error * counts;
+                if (!found || weighted_error < weighted_best ||
+                    (weighted_error == weighted_best && steps - 1 > result->top)) {
+                    found = true;
+                    best_error = error;
+                    best_counts = counts;
+                    result->frequency = (input_frequency + counts / 2) / counts;
+                    result->top = steps - 1;
+                    result->gclk_divisor = divisor;
+                    result->prescaler_index = p;
+                    result->counter_bits = widths[w];
+                }
+            }
+        }
+    }
+    return found;
+}
+
 void tc_enable_interrupts(uint8_t tc_index) {
     NVIC_DisableIRQ(tc_irq[tc_index]);
     NVIC_ClearPendingIRQ(tc_irq[tc_index]);
@@ -83,66 +185,232 @@ void tc_disable_interrupts(uint8_t tc_index) {
 }
 
 void tcc_set_enable(Tcc* tcc, bool enable) {
+    // CTRLA writes are dropped while an earlier one is still synchronizing.
+    SYNC_WAIT(tcc->SYNCBUSY.bit.ENABLE != 0);
     tcc->CTRLA.bit.ENABLE = enable;
-    while (tcc->SYNCBUSY.bit.ENABLE != 0) {
-        /* Wait for sync */
-    }
+    // Enable-protected registers can only change once a disable has synchronized, and callers
+    // expect the timer to be counting once an enable returns.
+    SYNC_WAIT(tcc->SYNCBUSY.bit.ENABLE != 0);
 }
 
 void tc_reset(Tc* tc) {
+    tc_wait_for_sync(tc);
     tc->COUNT16.CTRLA.bit.SWRST = 1;
-    while (tc->COUNT16.CTRLA.bit.SWRST == 1) {
+    SYNC_WAIT(tc->COUNT16.CTRLA.bit.SWRST == 1);
+}
+
+void tcc_reset(Tcc* tcc) {
+    tcc->CTRLA.bit.SWRST = 1;
+    SYNC_WAIT(tcc->CTRLA.bit.SWRST == 1 || tcc->SYNCBUSY.bit.SWRST == 1);
+}
+
+static void tc_write_count(Tc* tc, uint32_t count) {
+    switch (tc->COUNT16.CTRLA.bit.MODE) {
+        case TC_CTRLA_MODE_COUNT8_Val:
+            tc->COUNT8.COUNT.reg = count;
+            break;
+        case TC_CTRLA_MODE_COUNT16_Val:
+            tc->COUNT16.COUNT.reg = count;
+            break;
+        default:
+            tc->COUNT32.COUNT.reg = count;
+            break;
     }
 }
 
-#ifdef SAM_D5X_E5X
-#define TC_OFFSET 0
-#endif
-#ifdef SAMD21
-#define TC_OFFSET 3
-#endif
+// Only a tag for event_channel_owner().
+static const uint8_t timer_group_owner;
+
+static void timer_group_disable(const timer_group_member_t* members, uint8_t count,
+                                const uint16_t* patterns) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            tc_set_enable(tc_insts[members[i].index], false);
+        } else {
+            Tcc* tcc = tcc_insts[members[i].index];
+            tcc_set_enable(tcc, false);
+            SYNC_WAIT(tcc->SYNCBUSY.bit.PATT != 0);
+            tcc->PATT.reg = patterns[members[i].index];
+        }
+    }
+}
+
+bool timer_start_group(const timer_group_member_t* members, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            if (tc_insts[members[i].index]->COUNT16.CTRLA.bit.ENABLE == 1) {
+                return false;
+            }
+        } else if (tcc_insts[members[i].index]->CTRLA.bit.ENABLE == 1) {
+            return false;
+        }
+    }
+    uint8_t channel = claim_sync_event_channel(&timer_group_owner);
+    if (channel >= EVSYS_CHANNELS) {
+        return false;
+    }
+
+    // Enabling starts a counter even with the START action so every member is stopped and rewound
+    // before the shared start. Until then the pattern generator holds TCC outputs low. TCs don't
+    // have one so their outputs can move for the few clocks between the enable and the stop.
+    uint16_t patterns[TCC_INST_NUM];
+    // Every phase writes all members before waiting on any of them so the sync delays overlap.
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            Tc* tc = tc_insts[members[i].index];
+            tc->COUNT16.EVCTRL.reg = (tc->COUNT16.EVCTRL.reg & ~TC_EVCTRL_EVACT_Msk) |
+                                     TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_START;
+            connect_event_user_to_channel(tc_event_user_ids[members[i].index], channel);
+        } else {
+            Tcc* tcc = tcc_insts[members[i].index];
+            tcc->EVCTRL.reg = (tcc->EVCTRL.reg & ~TCC_EVCTRL_EVACT0_Msk) |
+                              TCC_EVCTRL_TCEI0 | TCC_EVCTRL_EVACT0_START;
+            SYNC_WAIT(tcc->SYNCBUSY.bit.PATT != 0);
+            patterns[members[i].index] = tcc->PATT.reg;
+            tcc->PATT.reg = TCC_PATT_PGE(0xff);
+            connect_event_user_to_channel(tcc_event_user_ids[members[i].index], channel);
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (!members[i].is_tc) {
+            SYNC_WAIT(tcc_insts[members[i].index]->SYNCBUSY.bit.PATT != 0);
+        }
+    }
+    // Stop each one as soon as its enable has synchronized.
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            tc_insts[members[i].index]->COUNT16.CTRLA.bit.ENABLE = 1;
+        } else {
+            tcc_insts[members[i].index]->CTRLA.bit.ENABLE = 1;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            Tc* tc = tc_insts[members[i].index];
+            tc_wait_for_sync(tc);
+            tc->COUNT16.CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+        } else {
+            Tcc* tcc = tcc_insts[members[i].index];
+            SYNC_WAIT(tcc->SYNCBUSY.bit.ENABLE != 0);
+            tcc->CTRLBSET.reg = TCC_CTRLBSET_CMD_STOP;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            Tc* tc = tc_insts[members[i].index];
+            tc_wait_for_sync(tc);
+            tc_write_count(tc, 0);
+        } else {
+            Tcc* tcc = tcc_insts[members[i].index];
+            SYNC_WAIT(tcc->SYNCBUSY.bit.CTRLB != 0);
+            tcc->COUNT.reg = 0;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (members[i].is_tc) {
+            tc_wait_for_sync(tc_insts[members[i].index]);
+        } else {
+            SYNC_WAIT(tcc_insts[members[i].index]->SYNCBUSY.bit.COUNT != 0);
+        }
+    }
+
+    // GCLK0 is always running. The event is resynchronized to each member's own clock anyway.
+    bool started = trigger_software_event(channel, 0);
+
+    // The START action stays set but nothing drives the event inputs once they're disconnected.
+    release_event_channel(channel);
+    if (!started) {
+        timer_group_disable(members, count, patterns);
+        return false;
+    }
+    // The counters are already in step so the outputs coming back a few clocks apart is harmless.
+    for (uint8_t i = 0; i < count; i++) {
+        if (!members[i].is_tc) {
+            Tcc* tcc = tcc_insts[members[i].index];
+            tcc->PATT.reg = patterns[members[i].index];
+        }
+    }
+    return true;
+}
 
+void timer_set_callback(bool is_tc, uint8_t index, void (*callback)(void* context), void* context) {
+    timer_callback_t* entry;
+    if (is_tc) {
+        entry = &tc_callbacks[index];
+    } else {
+        entry = &tcc_callbacks[index];
+    }
+    // Keep the handler from seeing the new callback with the old context.
+    common_hal_mcu_disable_interrupts();
+    entry->callback = callback;
+    entry->context = context;
+    common_hal_mcu_enable_interrupts();
+}
+
+static inline void dispatch(timer_callback_t* entry, bool is_tc, uint8_t index) {
+    IRQ_LATENCY_ENTRY(entry_cycles);
+    IRQ_LATENCY_RECORD(IRQ_LATENCY_TIMER, entry_cycles);
+    if (entry->callback != NULL) {
+        entry->callback(entry->context);
+    } else {
+        shared_timer_handler(is_tc, index);
+    }
+    IRQ_LATENCY_EXIT(IRQ_LATENCY_TIMER, entry_cycles);
+}
+
+#if TIMER_TCC_HANDLERS & (1 << 0)
 void TCC0_Handler(void) {
-    shared_timer_handler(false, 0);
+    dispatch(&tcc_callbacks[0], false, 0);
 }
+#endif
+#if TIMER_TCC_HANDLERS & (1 << 1)
 void TCC1_Handler(void) {
-    shared_timer_handler(false, 1);
+    dispatch(&tcc_callbacks[1], false, 1);
 }
+#endif
+#if TIMER_TCC_HANDLERS & (1 << 2)
 void TCC2_Handler(void) {
-    shared_timer_handler(false, 2);
+    dispatch(&tcc_callbacks[2], false, 2);
 }
+#endif
 // TC0 - TC2 only exist on the SAM_D5X_E5X
-#ifdef TC0
+#if defined(TC0) && (TIMER_TC_HANDLERS & (1 << 0))
 void TC0_Handler(void) {
-    shared_timer_handler(true, 0);
+    dispatch(&tc_callbacks[0], true, 0);
 }
 #endif
-#ifdef TC1
+#if defined(TC1) && (TIMER_TC_HANDLERS & (1 << 1))
 void TC1_Handler(void) {
-    shared_timer_handler(true, 1);
+    dispatch(&tc_callbacks[1], true, 1);
 }
 #endif
-#ifdef TC2
+#if defined(TC2) && (TIMER_TC_HANDLERS & (1 << 2))
 void TC2_Handler(void) {
-    shared_timer_handler(true, 2);
+    dispatch(&tc_callbacks[2], true, 2);
 }
 #endif
+#if TIMER_TC_HANDLERS & (1 << 3)
 void TC3_Handler(void) {
-    shared_timer_handler(true, 3 - TC_OFFSET);
+    dispatch(&tc_callbacks[3 - TC_OFFSET], true, 3 - TC_OFFSET);
 }
+#endif
+#if TIMER_TC_HANDLERS & (1 << 4)
 void TC4_Handler(void) {
-    shared_timer_handler(true, 4 - TC_OFFSET);
+    dispatch(&tc_callbacks[4 - TC_OFFSET], true, 4 - TC_OFFSET);
 }
+#endif
+#if TIMER_TC_HANDLERS & (1 << 5)
 void TC5_Handler(void) {
-    shared_timer_handler(true, 5 - TC_OFFSET);
+    dispatch(&tc_callbacks[5 - TC_OFFSET], true, 5 - TC_OFFSET);
 }
-#ifdef TC6
+#endif
+#if defined(TC6) && (TIMER_TC_HANDLERS & (1 << 6))
 void TC6_Handler(void) {
-    shared_timer_handler(true, 6 - TC_OFFSET);
+    dispatch(&tc_callbacks[6 - TC_OFFSET], true, 6 - TC_OFFSET);
 }
 #endif
-#ifdef TC7
+#if defined(TC7) && (TIMER_TC_HANDLERS & (1 << 7))
 void TC7_Handler(void) {
-    shared_timer_handler(true, 7 - TC_OFFSET);
+    dispatch(&tc_callbacks[7 - TC_OFFSET], true, 7 - TC_OFFSET);
 }
 #endif
@@ -29,31 +29,100 @@
 #include <stdbool.h>
 #include "include/sam.h"
 
+#include "samd_peripherals_config.h"
+
+// Bit masks, by datasheet number, of the TCs and TCCs whose interrupt handlers are defined here.
+// Clear a bit to leave that vector free for another handler and save the code space.
+#ifndef TIMER_TC_HANDLERS
+#define TIMER_TC_HANDLERS 0xff
+#endif
+#ifndef TIMER_TCC_HANDLERS
+#define TIMER_TCC_HANDLERS 0x07
+#endif
+
 extern const uint16_t prescaler[8];
 
 #ifdef SAMD21
 extern const uint8_t tcc_cc_num[3];
+extern const uint8_t tcc_counter_bits[3];
 extern const uint8_t tc_gclk_ids[TC_INST_NUM];
 extern const uint8_t tcc_gclk_ids[3];
 #endif
 #ifdef SAM_D5X_E5X
 extern const uint8_t tcc_cc_num[5];
+extern const uint8_t tcc_counter_bits[5];
 extern const uint8_t tc_gclk_ids[TC_INST_NUM];
 extern const uint8_t tcc_gclk_ids[TCC_INST_NUM];
 #endif
 extern Tc* const tc_insts[TC_INST_NUM];
 extern Tcc* const tcc_insts[TCC_INST_NUM];
+extern IRQn_Type const tc_irq[TC_INST_NUM];
+// DMA trigger for each TC's overflow. Its compare match triggers follow it in order.
+extern const uint8_t tc_ovf_dmac_ids[TC_INST_NUM];
+extern const uint8_t tc_event_user_ids[TC_INST_NUM];
+// DMA trigger for each TCC's overflow. Its compare match triggers follow it in order.
+extern const uint8_t tcc_ovf_dmac_ids[TCC_INST_NUM];
+// Event user for each TCC's event input 0. Input 1 follows it.
+extern const uint8_t tcc_event_user_ids[TCC_INST_NUM];
+
+// Offset between a TC's index into tc_insts and its number in the datasheet.
+#ifdef SAM_D5X_E5X
+#define TC_OFFSET 0
+#endif
+#ifdef SAMD21
+#define TC_OFFSET 3
+#endif
+
+// The settings that best produce a timer frequency. The timer counts from zero to top so each
+// period has top + 1 steps. gclk_divisor is relative to the clock already connected to the timer.
+typedef struct {
+    uint32_t frequency;
+    uint32_t top;
+    uint16_t gclk_divisor;
+    uint8_t prescaler_index;
+    uint8_t counter_bits;
+} timer_period_t;
+
+typedef struct {
+    uint8_t index;
+    bool is_tc;
+} timer_group_member_t;
 
+// Turns the timer's clocks on for good and connects gclk_index even if another timer sharing the
+// clock channel uses a different generator. Prefer timer_claim_clocks() in new code.
 void turn_on_clocks(bool is_tc, uint8_t index, uint32_t gclk_index);
+// Returns false without claiming anything when claims already have the timer's clock channel on
+// another generator. Timers that share a channel must use the same gclk.
+bool timer_claim_clocks(bool is_tc, uint8_t index, uint32_t gclk_index);
+// Drops the claims taken by timer_claim_clocks. Call it after the timer has been reset.
+void timer_release_clocks(bool is_tc, uint8_t index);
 void tc_set_enable(Tc* tc, bool enable);
 void tcc_set_enable(Tcc* tcc, bool enable);
 void tc_wait_for_sync(Tc* tc);
 void tc_reset(Tc* tc);
+void tcc_reset(Tcc* tcc);
+void tc_configure_period(Tc* tc, const timer_period_t* period);
+void tc_configure_capture(Tc* tc, uint8_t prescaler_index, uint8_t event_action, bool invert_event);
+void tc_enable_continuous_read(Tc* tc);
+uint16_t tc_read_count16(Tc* tc);
+uint32_t tc_read_count32(Tc* tc);
 uint8_t find_free_timer(void);
 
+bool timer_solve_period(bool is_tc, uint8_t index, uint32_t frequency, uint32_t resolution,
+                        uint16_t max_gclk_divisor, uint8_t max_counter_bits, timer_period_t* result);
+
+// Enable configured but disabled timers so that they all start counting from zero on the same
+// clock edge. Each member's event input 0 is set to START so it can't be used for anything else.
+// The start takes one of the synchronous capable event channels for the duration of the call.
+// TCC outputs stay low until the start. On failure every member is disabled again.
+bool timer_start_group(const timer_group_member_t* members, uint8_t count);
+
 void tc_enable_interrupts(uint8_t tc_index);
 void tc_disable_interrupts(uint8_t tc_index);
 
+// Route a timer's interrupt directly to callback. Pass NULL to go back to shared_timer_handler().
+void timer_set_callback(bool is_tc, uint8_t index, void (*callback)(void* context), void* context);
+
 extern void shared_timer_handler(bool is_tc, uint8_t index);
 
 // Handlers
@@ -0,0 +1,244 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "samd/timestamp.h"
+
+#include "samd/clocks.h"
+#include "samd/timers.h"
+
+#include "shared-bindings/microcontroller/__init__.h"
+
+static uint8_t timestamp_tc = 0xff;
+static uint32_t timestamp_tick_frequency;
+static volatile uint32_t timestamp_overflows;
+static void (*timestamp_alarm_callback)(void);
+// MC0 can't be set from software so timestamp_pend_alarm() flags the alarm here instead.
+static volatile bool timestamp_alarm_pended;
+
+// timestamp_ns() counts from here so that it stays continuous when the tick frequency changes.
+static uint64_t timestamp_base_ticks;
+static uint64_t timestamp_base_ns;
+
+static void timestamp_timer_handler(void* context);
+
+static void timestamp_clock_changed(void* context, clock_change_t change) {
+    (void) context;
+    common_hal_mcu_disable_interrupts();
+    uint64_t ticks = timestamp_ticks();
+    // Time spent relocking is counted at the old rate.
+    timestamp_base_ns += timestamp_ticks_to_ns(ticks - timestamp_base_ticks);
+    timestamp_base_ticks = ticks;
+    if (change == CLOCK_CHANGE_AFTER) {
+        timestamp_tick_frequency = clock_get_frequency(1, tc_gclk_ids[timestamp_tc]);
+    }
+    common_hal_mcu_enable_interrupts();
+}
+
+bool timestamp_init(uint8_t tc_index, uint8_t gclk) {
+    // COUNT32 pairs an even-numbered TC with the odd one after it.
+    if (timestamp_tc != 0xff || tc_index + 1 >= TC_INST_NUM || (tc_index + TC_OFFSET) % 2 != 0) {
+        return false;
+    }
+    Tc* tc = tc_insts[tc_index];
+    if (tc->COUNT16.CTRLA.bit.ENABLE == 1 || tc_insts[tc_index + 1]->COUNT16.CTRLA.bit.ENABLE == 1 ||
+        !clock_add_notifier(timestamp_clock_changed, NULL)) {
+        return false;
+    }
+
+    // The slave shares the master's generic clock but still needs its bus clock.
+    if (!timer_claim_clocks(true, tc_index, gclk)) {
+        clock_remove_notifier(timestamp_clock_changed, NULL);
+        return false;
+    }
+    if (!timer_claim_clocks(true, tc_index + 1, gclk)) {
+        timer_release_clocks(true, tc_index);
+        clock_remove_notifier(timestamp_clock_changed, NULL);
+        return false;
+    }
+    tc_reset(tc);
+    tc->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_PRESCALER_DIV1;
+    tc_wait_for_sync(tc);
+    tc_enable_continuous_read(tc);
+
+    timestamp_overflows = 0;
+    timestamp_base_ticks = 0;
+    timestamp_base_ns = 0;
+    timestamp_tick_frequency = clock_get_frequency(1, tc_gclk_ids[tc_index]);
+    timestamp_tc = tc_index;
+
+    tc->COUNT32.INTFLAG.reg = TC_INTFLAG_OVF;
+    tc->COUNT32.INTENSET.reg = TC_INTENSET_OVF;
+    timer_set_callback(true, tc_index, timestamp_timer_handler, NULL);
+    tc_enable_interrupts(tc_index);
+
+    #ifdef SAM_D5X_E5X
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+
+    tc_set_enable(tc, true);
+    return true;
+}
+
+void timestamp_deinit(void) {
+    if (timestamp_tc == 0xff) {
+        return;
+    }
+    Tc* tc = tc_insts[timestamp_tc];
+    tc_disable_interrupts(timestamp_tc);
+    timer_set_callback(true, timestamp_tc, NULL, NULL);
+    timestamp_alarm_callback = NULL;
+    tc_set_enable(tc, false);
+    tc_reset(tc);
+    timer_release_clocks(true, timestamp_tc);
+    timer_release_clocks(true, timestamp_tc + 1);
+    clock_remove_notifier(timestamp_clock_changed, NULL);
+    timestamp_tc = 0xff;
+}
+
+bool timestamp_enabled(void) {
+    return timestamp_tc != 0xff;
+}
+
+uint8_t timestamp_tc_index(void) {
+    return timestamp_tc;
+}
+
+uint64_t timestamp_ticks(void) {
+    if (timestamp_tc == 0xff) {
+        return 0;
+    }
+    Tc* tc = tc_insts[timestamp_tc];
+    uint32_t high;
+    uint32_t low;
+    bool pending;
+    // Retry if the overflow interrupt ran while we were reading. Otherwise high and pending are
+    // consistent because the handler updates them together.
+    do {
+        high = timestamp_overflows;
+        low = tc_read_count32(tc);
+        pending = tc->COUNT32.INTFLAG.bit.OVF;
+    } while (high != timestamp_overflows);
+    // The counter wrapped but the interrupt hasn't been serviced yet. This happens when we're
+    // called with interrupts disabled or from a higher priority interrupt. A low count means the
+    // wrap happened before we read it.
+    if (pending && low < 0x80000000) {
+        high++;
+    }
+    return ((uint64_t) high << 32) | low;
+}
+
+uint32_t timestamp_ticks32(void) {
+    if (timestamp_tc == 0xff) {
+        return 0;
+    }
+    return tc_read_count32(tc_insts[timestamp_tc]);
+}
+
+uint32_t timestamp_frequency(void) {
+    return timestamp_tick_frequency;
+}
+
+uint64_t timestamp_ticks_to_ns(uint64_t ticks) {
+    if (timestamp_tick_frequency == 0) {
+        return 0;
+    }
+    // Split the conversion so that the multiply can't overflow.
+    uint64_t seconds = ticks / timestamp_tick_frequency;
+    uint64_t remainder = ticks % timestamp_tick_frequency;
+    return seconds * 1000000000ULL + remainder * 1000000000ULL / timestamp_tick_frequency;
+}
+
+uint64_t timestamp_ns(void) {
+    common_hal_mcu_disable_interrupts();
+    uint64_t base_ticks = timestamp_base_ticks;
+    uint64_t base_ns = timestamp_base_ns;
+    common_hal_mcu_enable_interrupts();
+    return base_ns + timestamp_ticks_to_ns(timestamp_ticks() - base_ticks);
+}
+
+void timestamp_set_alarm_callback(void (*callback)(void)) {
+    timestamp_alarm_callback = callback;
+}
+
+bool timestamp_set_alarm(uint64_t tick) {
+    if (timestamp_tc == 0xff) {
+        return false;
+    }
+    Tc* tc = tc_insts[timestamp_tc];
+    tc->COUNT32.INTENCLR.reg = TC_INTENCLR_MC0;
+    tc->COUNT32.CC[0].reg = (uint32_t) tick;
+    tc_wait_for_sync(tc);
+    tc->COUNT32.INTFLAG.reg = TC_INTFLAG_MC0;
+    tc->COUNT32.INTENSET.reg = TC_INTENSET_MC0;
+    // The compare only matches on the way past so check that we didn't miss it while it synced.
+    if (timestamp_ticks() >= tick) {
+        tc->COUNT32.INTENCLR.reg = TC_INTENCLR_MC0;
+        return false;
+    }
+    return true;
+}
+
+void timestamp_clear_alarm(void) {
+    if (timestamp_tc == 0xff) {
+        return;
+    }
+    tc_insts[timestamp_tc]->COUNT32.INTENCLR.reg = TC_INTENCLR_MC0;
+    timestamp_alarm_pended = false;
+}
+
+void timestamp_pend_alarm(void) {
+    if (timestamp_tc == 0xff) {
+        return;
+    }
+    timestamp_alarm_pended = true;
+    NVIC_SetPendingIRQ(tc_irq[timestamp_tc]);
+}
+
+static void timestamp_timer_handler(void* context) {
+    (void) context;
+    Tc* tc = tc_insts[timestamp_tc];
+    if (tc->COUNT32.INTFLAG.bit.OVF == 1) {
+        // Clear and count together so that readers never see one without the other.
+        common_hal_mcu_disable_interrupts();
+        tc->COUNT32.INTFLAG.reg = TC_INTFLAG_OVF;
+        timestamp_overflows++;
+        common_hal_mcu_enable_interrupts();
+    }
+    bool pended = timestamp_alarm_pended;
+    if (pended || (tc->COUNT32.INTFLAG.bit.MC0 == 1 && tc->COUNT32.INTENSET.bit.MC0 == 1)) {
+        timestamp_alarm_pended = false;
+        tc->COUNT32.INTENCLR.reg = TC_INTENCLR_MC0;
+        tc->COUNT32.INTFLAG.reg = TC_INTFLAG_MC0;
+        if (timestamp_alarm_callback != NULL) {
+            timestamp_alarm_callback();
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_ATMEL_SAMD_TIMESTAMP_H
+#define MICROPY_INCLUDED_ATMEL_SAMD_TIMESTAMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/sam.h"
+
+// A free running 64-bit time base. The low 32 bits come from a TC pair in COUNT32 mode and the
+// high 32 bits are counted in its overflow interrupt, which is registered with
+// timer_set_callback(). tc_index must be an even-numbered TC (the COUNT32 master) and the next TC
+// is used as its slave.
+bool timestamp_init(uint8_t tc_index, uint8_t gclk);
+void timestamp_deinit(void);
+bool timestamp_enabled(void);
+uint8_t timestamp_tc_index(void);
+
+// Safe to call from both thread and interrupt context, including with interrupts disabled.
+uint64_t timestamp_ticks(void);
+// Only the counter. It wraps but is cheaper for timing short intervals in interrupt handlers.
+uint32_t timestamp_ticks32(void);
+// The tick frequency follows the TC's generator when clock_set_performance_level() changes it.
+// timestamp_ns() stays continuous but delays already handed out in ticks, such as to the timer
+// wheel or eic_storm, aren't rescaled. Use a generator that doesn't follow DPLL0 to avoid that.
+uint32_t timestamp_frequency(void);
+uint64_t timestamp_ticks_to_ns(uint64_t ticks);
+uint64_t timestamp_ns(void);
+
+// A single one shot alarm on the timestamp TC's CC0. The tick must be less than 2^32 ticks in the
+// future. Returns false when the tick has already passed, in which case the callback won't run.
+void timestamp_set_alarm_callback(void (*callback)(void));
+bool timestamp_set_alarm(uint64_t tick);
+void timestamp_clear_alarm(void);
+// Runs the alarm callback from the timer interrupt as soon as possible, for an alarm that is
+// already due.
+void timestamp_pend_alarm(void);
+
+#ifdef SAM_D5X_E5X
+// The Cortex-M4 cycle counter. It wraps every 2^32 CPU cycles so it's only good for short
+// intervals but it costs a single load. Enabled by timestamp_init().
+static inline uint32_t timestamp_cycles(void) {
+    return DWT->CYCCNT;
+}
+#endif
+
+#endif  // MICROPY_INCLUDED_ATMEL_SAMD_TIMESTAMP_H
@@ -39,4 +39,24 @@
 // example, CircuitPython uses this to add the Python type info into the struct.
 #define PIN_PREFIX_VALUES
 
+// Bit masks, by datasheet number, of the TC and TCC interrupt handlers that timers.c defines. Only
+// include the timers in use to save code space or to define their handlers elsewhere.
+// #define TIMER_TC_HANDLERS 0xff
+// #define TIMER_TCC_HANDLERS 0x07
+
+// Count the waits on peripheral register synchronization and the cycles they take. Read them with
+// sync_get_stats().
+// #define SYNC_WAIT_STATS 1
+
+// Measure how long interrupt handlers take to reach their callbacks. Read them with
+// irq_latency_get_stats().
+// #define IRQ_LATENCY_STATS 1
+
+// Set to 0 to leave the EVSYS interrupt handlers to the application. They dispatch to callbacks
+// registered with event_channel_set_callback().
+// #define EVSYS_HANDLER 1
+
+// Number of drivers that can register with clock_add_notifier() to hear about clock changes.
+// #define CLOCK_CHANGE_NOTIFIERS 8
+
 #endif // SAMD_PERIPHERALS_CONFIG_H
@@ -0,0 +1,49 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Just enough of the device headers for the register-free code to build on the host. The counts
+// are a SAMD21's.
+
+#ifndef TESTS_INCLUDE_SAM_H
+#define TESTS_INCLUDE_SAM_H
+
+#include <stdint.h>
+
+#define SAMD21 1
+
+typedef struct Sercom Sercom;
+
+typedef struct {
+    uint32_t reg[4];
+} DmacDescriptor;
+
+#define EVSYS_CHANNELS 12
+#define EVSYS_GENERATORS 73
+#define EVSYS_USERS 23
+#define EVSYS_ID_GEN_DMAC_CH_0 30
+#define DMAC_EVOUT_NUM 4
+
+#endif  // TESTS_INCLUDE_SAM_H
@@ -0,0 +1,129 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "samd/dpll.h"
+
+static int failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// The output the registers will actually produce.
+static uint64_t output(uint32_t reference_frequency, const dpll_config_t* config, bool divided) {
+    uint32_t divisor = divided ? 2 * (config->div + 1) : 1;
+    uint32_t ratio = (config->ldr + 1) * 32 + config->ldrfrac;
+    return ((uint64_t) reference_frequency * ratio) / (32 * divisor);
+}
+
+static void test_gclk(void) {
+    dpll_config_t config;
+    // DPLL0's performance levels from its 2MHz reference.
+    CHECK(dpll_solve_reference(2000000, false, 120000000, &config));
+    CHECK(config.ldr == 59 && config.ldrfrac == 0 && config.div == 0);
+    CHECK(config.frequency == 120000000);
+    CHECK(config.filter == 0x5);
+    CHECK(dpll_solve_reference(2000000, false, 96000000, &config));
+    CHECK(config.frequency == 96000000);
+    CHECK(dpll_solve_reference(2000000, false, 200000000, &config));
+    CHECK(config.ldr == 99 && config.frequency == 200000000);
+}
+
+static void test_xosc32k(void) {
+    dpll_config_t config;
+    CHECK(dpll_solve_reference(32768, false, 120000000, &config));
+    CHECK(config.frequency == output(32768, &config, false));
+    // Steps are 1kHz so the closest is within half of one.
+    CHECK(config.frequency >= 120000000 - 512 && config.frequency <= 120000000 + 512);
+    // No filter is below a tenth of 32kHz so it gets the narrowest.
+    CHECK(config.filter == 0xe);
+}
+
+static void test_xosc(void) {
+    dpll_config_t config;
+    // 12MHz must be divided by 4 to get under 3.2MHz.
+    CHECK(dpll_solve_reference(12000000, true, 120000000, &config));
+    CHECK(config.div == 1 && config.ldr == 39 && config.ldrfrac == 0);
+    CHECK(config.frequency == 120000000);
+    // 16MHz divided by 6 isn't a whole number of Hz but is still exact.
+    CHECK(dpll_solve_reference(16000000, true, 120000000, &config));
+    CHECK(config.div == 2 && config.ldr == 44 && config.ldrfrac == 0);
+    CHECK(config.frequency == 120000000);
+    CHECK(output(16000000, &config, true) == 120000000);
+}
+
+static void test_audio(void) {
+    dpll_config_t config;
+    // 2048 and 2560 times 48kHz and 44.1kHz.
+    const uint32_t targets[] = {98304000, 112896000};
+    const uint32_t crystals[] = {12000000, 16000000};
+    for (uint8_t i = 0; i < 2; i++) {
+        for (uint8_t j = 0; j < 2; j++) {
+            CHECK(dpll_solve_reference(crystals[j], true, targets[i], &config));
+            CHECK(config.frequency == output(crystals[j], &config, true));
+            uint32_t error = config.frequency > targets[i] ? config.frequency - targets[i] :
+                             targets[i] - config.frequency;
+            // Within a hundred parts per million.
+            CHECK(error <= targets[i] / 10000);
+        }
+    }
+}
+
+static void test_out_of_range(void) {
+    dpll_config_t config;
+    // Output limits.
+    CHECK(!dpll_solve_reference(2000000, false, 48000000, &config));
+    CHECK(!dpll_solve_reference(2000000, false, 250000000, &config));
+    CHECK(!dpll_solve_reference(32768, false, 48000000, &config));
+    // Reference limits. Only XOSC references can be divided down.
+    CHECK(!dpll_solve_reference(16000, false, 120000000, &config));
+    CHECK(!dpll_solve_reference(4000000, false, 120000000, &config));
+    CHECK(dpll_solve_reference(4000000, true, 120000000, &config));
+    CHECK(!dpll_solve_reference(0, true, 120000000, &config));
+    CHECK(!dpll_solve_reference(32768, true, 120000000, &config));
+}
+
+int main(void) {
+    test_gclk();
+    test_xosc32k();
+    test_xosc();
+    test_audio();
+    test_out_of_range();
+    if (failures != 0) {
+        printf("%d dpll checks failed\n", failures);
+        return 1;
+    }
+    printf("dpll checks passed\n");
+    return 0;
+}
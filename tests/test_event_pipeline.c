@@ -0,0 +1,167 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "samd/event_pipeline.h"
+
+#include "samd/dma.h"
+#include "samd/events.h"
+
+static int failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static const DmacDescriptor descriptor;
+
+static event_pipeline_error_t validate(const event_route_t* routes, uint8_t route_count,
+                                       const event_dma_stage_t* dma_stages, uint8_t dma_stage_count) {
+    event_pipeline_config_t config = {
+        .routes = routes,
+        .dma_stages = dma_stages,
+        .route_count = route_count,
+        .dma_stage_count = dma_stage_count,
+    };
+    return event_pipeline_validate(&config);
+}
+
+static void test_valid(void) {
+    // Pin edge to a TC capture and the TC's DMA channel out to a second user.
+    event_route_t routes[] = {
+        {.generator = 12, .user_count = 1, .users = {10}, .gclk = EVENT_PIPELINE_ASYNC},
+        {.generator = EVSYS_ID_GEN_DMAC_CH_0 + 1, .user_count = 2, .users = {11, 12}, .gclk = 0},
+    };
+    event_dma_stage_t stages[] = {
+        {.descriptor = &descriptor, .channel = 1, .trigger = 20, .output_event = true},
+    };
+    CHECK(validate(routes, 2, stages, 1) == EVENT_PIPELINE_OK);
+    CHECK(validate(NULL, 0, NULL, 0) == EVENT_PIPELINE_OK);
+}
+
+static void test_routes(void) {
+    event_route_t routes[EVENT_PIPELINE_MAX_ROUTES + 1];
+    for (uint8_t r = 0; r < EVENT_PIPELINE_MAX_ROUTES + 1; r++) {
+        routes[r] = (event_route_t) {.generator = 1, .user_count = 1, .users = {r},
+                                     .gclk = EVENT_PIPELINE_ASYNC};
+    }
+    CHECK(validate(routes, EVENT_PIPELINE_MAX_ROUTES, NULL, 0) == EVENT_PIPELINE_OK);
+    CHECK(validate(routes, EVENT_PIPELINE_MAX_ROUTES + 1, NULL, 0) == EVENT_PIPELINE_TOO_MANY_ROUTES);
+
+    event_route_t route = {.generator = 1, .user_count = EVENT_PIPELINE_MAX_USERS + 1,
+                           .gclk = EVENT_PIPELINE_ASYNC};
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_TOO_MANY_USERS);
+}
+
+static void test_generators(void) {
+    event_route_t route = {.generator = 0, .user_count = 1, .users = {0}, .gclk = EVENT_PIPELINE_ASYNC};
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_BAD_GENERATOR);
+    route.generator = EVSYS_GENERATORS + 1;
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_BAD_GENERATOR);
+    route.generator = EVSYS_GENERATORS;
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_OK);
+}
+
+static void test_users(void) {
+    event_route_t route = {.generator = 1, .user_count = 1, .users = {EVSYS_USERS},
+                           .gclk = EVENT_PIPELINE_ASYNC};
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_BAD_USER);
+    route.users[0] = EVSYS_USERS - 1;
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_OK);
+
+    // A user can only listen to one channel, whether it's repeated in a route or across two.
+    event_route_t repeated = {.generator = 1, .user_count = 3, .users = {4, 5, 4},
+                              .gclk = EVENT_PIPELINE_ASYNC};
+    CHECK(validate(&repeated, 1, NULL, 0) == EVENT_PIPELINE_USER_REUSED);
+    event_route_t routes[] = {
+        {.generator = 1, .user_count = 2, .users = {4, 5}, .gclk = EVENT_PIPELINE_ASYNC},
+        {.generator = 2, .user_count = 2, .users = {6, 5}, .gclk = EVENT_PIPELINE_ASYNC},
+    };
+    CHECK(validate(routes, 2, NULL, 0) == EVENT_PIPELINE_USER_REUSED);
+    routes[1].users[1] = 7;
+    CHECK(validate(routes, 2, NULL, 0) == EVENT_PIPELINE_OK);
+}
+
+static void test_sync_routes(void) {
+    event_route_t routes[EVSYS_SYNCH_NUM + 1];
+    for (uint8_t r = 0; r < EVSYS_SYNCH_NUM + 1; r++) {
+        routes[r] = (event_route_t) {.generator = 1, .user_count = 1, .users = {r}, .gclk = 0};
+    }
+    CHECK(validate(routes, EVSYS_SYNCH_NUM, NULL, 0) == EVENT_PIPELINE_OK);
+    CHECK(validate(routes, EVSYS_SYNCH_NUM + 1, NULL, 0) == EVENT_PIPELINE_TOO_MANY_SYNC_ROUTES);
+    routes[EVSYS_SYNCH_NUM].gclk = EVENT_PIPELINE_ASYNC;
+    CHECK(validate(routes, EVSYS_SYNCH_NUM + 1, NULL, 0) == EVENT_PIPELINE_OK);
+}
+
+static void test_dma_stages(void) {
+    event_dma_stage_t stages[] = {
+        {.descriptor = &descriptor, .channel = 0, .trigger = 20, .output_event = false},
+        {.descriptor = &descriptor, .channel = 1, .trigger = 21, .output_event = false},
+    };
+    CHECK(validate(NULL, 0, stages, 2) == EVENT_PIPELINE_OK);
+    stages[1].channel = DMA_CHANNEL_COUNT;
+    CHECK(validate(NULL, 0, stages, 2) == EVENT_PIPELINE_BAD_DMA_CHANNEL);
+    stages[1].channel = 1;
+    stages[1].descriptor = NULL;
+    CHECK(validate(NULL, 0, stages, 2) == EVENT_PIPELINE_BAD_DMA_CHANNEL);
+    stages[1].descriptor = &descriptor;
+    stages[1].channel = 0;
+    CHECK(validate(NULL, 0, stages, 2) == EVENT_PIPELINE_DMA_CHANNEL_REUSED);
+    stages[1].channel = 1;
+
+    // A DMA channel only generates events when its stage asks for them.
+    event_route_t route = {.generator = EVSYS_ID_GEN_DMAC_CH_0 + 1, .user_count = 1, .users = {0},
+                           .gclk = EVENT_PIPELINE_ASYNC};
+    CHECK(validate(&route, 1, stages, 2) == EVENT_PIPELINE_MISSING_DMA_EVENT);
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_MISSING_DMA_EVENT);
+    stages[1].output_event = true;
+    CHECK(validate(&route, 1, stages, 2) == EVENT_PIPELINE_OK);
+    // Generators past the DMA channels with event outputs aren't DMA channels.
+    route.generator = EVSYS_ID_GEN_DMAC_CH_0 + DMAC_EVOUT_NUM;
+    CHECK(validate(&route, 1, NULL, 0) == EVENT_PIPELINE_OK);
+}
+
+int main(void) {
+    test_valid();
+    test_routes();
+    test_generators();
+    test_users();
+    test_sync_routes();
+    test_dma_stages();
+    if (failures != 0) {
+        printf("%d event pipeline checks failed\n", failures);
+        return 1;
+    }
+    printf("event pipeline checks passed\n");
+    return 0;
+}
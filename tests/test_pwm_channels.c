@@ -0,0 +1,184 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "samd/pwm_assign.h"
+
+static int failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define TIMER_COUNT 4
+
+static pwm_assign_timer_t timers[TIMER_COUNT];
+
+static void reset_timers(void) {
+    memset(timers, 0, sizeof(timers));
+}
+
+// Option slots follow their order so slots[r] is also the index of the picked option.
+static pwm_assign_request_t request(uint32_t frequency, uint8_t option_count,
+                                   const pwm_assign_option_t* options) {
+    pwm_assign_request_t r = {.frequency = frequency, .option_count = option_count};
+    for (uint8_t i = 0; i < option_count; i++) {
+        r.options[i] = options[i];
+        r.options[i].slot = i;
+    }
+    return r;
+}
+
+static uint8_t picked_timer(const pwm_assign_request_t* r, uint8_t slot) {
+    return r->options[slot].timer;
+}
+
+static void test_sharing(void) {
+    reset_timers();
+    const pwm_assign_option_t a[] = {{.timer = 0, .channel = 0}, {.timer = 1, .channel = 0}};
+    const pwm_assign_option_t b[] = {{.timer = 1, .channel = 1}, {.timer = 0, .channel = 1}};
+    pwm_assign_request_t requests[2] = {request(1000, 2, a), request(1000, 2, b)};
+    uint8_t slots[2];
+    // Equal frequencies share one timer on separate channels.
+    CHECK(pwm_assign(requests, 2, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) == picked_timer(&requests[1], slots[1]));
+
+    // Different ones can't.
+    requests[1].frequency = 2000;
+    CHECK(pwm_assign(requests, 2, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) != picked_timer(&requests[1], slots[1]));
+
+    // Nor can two outputs on the same channel.
+    const pwm_assign_option_t c[] = {{.timer = 0, .channel = 0}, {.timer = 1, .channel = 0}};
+    requests[1] = request(1000, 2, c);
+    CHECK(pwm_assign(requests, 2, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) != picked_timer(&requests[1], slots[1]));
+
+    // The search leaves the timers as it found them.
+    for (uint8_t i = 0; i < TIMER_COUNT; i++) {
+        CHECK(timers[i].frequency == 0 && timers[i].channels == 0 && !timers[i].taken);
+    }
+}
+
+static void test_running_preferred(void) {
+    reset_timers();
+    timers[2].frequency = 1000;
+    timers[2].channels = 1 << 0;
+    const pwm_assign_option_t a[] = {{.timer = 1, .channel = 0}, {.timer = 2, .channel = 1}};
+    pwm_assign_request_t requests[1] = {request(1000, 2, a)};
+    uint8_t slots[1];
+    CHECK(pwm_assign(requests, 1, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) == 2);
+    CHECK(timers[2].frequency == 1000 && timers[2].channels == (1 << 0));
+
+    // Not at a different frequency.
+    requests[0].frequency = 500;
+    CHECK(pwm_assign(requests, 1, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) == 1);
+
+    // Nor on a channel that's already in use.
+    requests[0].frequency = 1000;
+    timers[2].channels |= 1 << 1;
+    CHECK(pwm_assign(requests, 1, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) == 1);
+
+    // Timers running something else are never used.
+    reset_timers();
+    timers[1].taken = true;
+    CHECK(pwm_assign(requests, 1, timers, slots));
+    CHECK(picked_timer(&requests[0], slots[0]) == 2);
+}
+
+static void test_fewest_timers(void) {
+    reset_timers();
+    // Taking each request's first option in order would use two timers. All of them fit on
+    // timer 2.
+    const pwm_assign_option_t a[] = {{.timer = 0, .channel = 0}, {.timer = 2, .channel = 0}};
+    const pwm_assign_option_t b[] = {{.timer = 1, .channel = 0}, {.timer = 2, .channel = 1}};
+    const pwm_assign_option_t c[] = {{.timer = 0, .channel = 1}, {.timer = 1, .channel = 1},
+                                     {.timer = 2, .channel = 2}};
+    pwm_assign_request_t requests[3] = {request(1000, 2, a), request(1000, 2, b), request(1000, 3, c)};
+    uint8_t slots[3];
+    CHECK(pwm_assign(requests, 3, timers, slots));
+    for (uint8_t r = 0; r < 3; r++) {
+        CHECK(picked_timer(&requests[r], slots[r]) == 2);
+    }
+
+    // A request with a single option is placed first and the others join it.
+    const pwm_assign_option_t d[] = {{.timer = 3, .channel = 0}, {.timer = 1, .channel = 2}};
+    const pwm_assign_option_t e[] = {{.timer = 1, .channel = 3}};
+    pwm_assign_request_t more[2] = {request(1000, 2, d), request(1000, 1, e)};
+    CHECK(pwm_assign(more, 2, timers, slots));
+    CHECK(picked_timer(&more[0], slots[0]) == 1);
+    CHECK(picked_timer(&more[1], slots[1]) == 1);
+}
+
+static void test_unsatisfiable(void) {
+    reset_timers();
+    const pwm_assign_option_t a[] = {{.timer = 0, .channel = 0}};
+    pwm_assign_request_t requests[2] = {request(1000, 1, a), request(2000, 1, a)};
+    uint8_t slots[PWM_CHANNELS_MAX_REQUESTS + 1];
+    CHECK(!pwm_assign(requests, 2, timers, slots));
+    // Same frequency but the same channel too.
+    requests[1].frequency = 1000;
+    CHECK(!pwm_assign(requests, 2, timers, slots));
+    CHECK(pwm_assign(requests, 1, timers, slots));
+
+    // A pin without any timer that can do PWM.
+    requests[1].option_count = 0;
+    CHECK(!pwm_assign(requests, 2, timers, slots));
+
+    timers[0].taken = true;
+    CHECK(!pwm_assign(requests, 1, timers, slots));
+    timers[0].taken = false;
+    timers[0].frequency = 500;
+    timers[0].channels = 1 << 1;
+    CHECK(!pwm_assign(requests, 1, timers, slots));
+
+    pwm_assign_request_t too_many[PWM_CHANNELS_MAX_REQUESTS + 1] = {{0}};
+    CHECK(!pwm_assign(too_many, PWM_CHANNELS_MAX_REQUESTS + 1, timers, slots));
+}
+
+int main(void) {
+    test_sharing();
+    test_running_preferred();
+    test_fewest_timers();
+    test_unsatisfiable();
+    if (failures != 0) {
+        printf("%d pwm channel checks failed\n", failures);
+        return 1;
+    }
+    printf("pwm channel checks passed\n");
+    return 0;
+}
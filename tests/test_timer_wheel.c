@@ -0,0 +1,247 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Scott Shawcroft for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "samd/timer_wheel.h"
+
+#include "samd/timestamp.h"
+
+// Drives the wheel with a simulated timestamp TC. The alarm interrupt is delivered by dispatch(),
+// sometimes late as if other interrupts held it off, and every expiry is checked against when it
+// should have happened.
+
+#define TIMER_COUNT 10000
+#define PERIODIC_EXPIRIES 4
+#define WHEEL_TICK (1ULL << TIMER_WHEEL_TICK_SHIFT)
+
+static int failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    timer_wheel_timer_t timer;
+    uint64_t since;         // When it was last started.
+    uint64_t next;          // When it should expire next, rounded up to a wheel tick.
+    uint64_t period;        // Rounded up to wheel ticks. Zero for one shot timers.
+    uint32_t expiries;
+    uint32_t expected_expiries;
+    bool restart;           // One shot timers that start themselves once more from their callback.
+} test_timer_t;
+
+static test_timer_t timers[TIMER_COUNT];
+static uint64_t random_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t now;
+static bool alarm_armed;
+static uint64_t alarm_tick;
+static bool alarm_pended;
+static void (*alarm_callback)(void);
+static bool in_alarm;
+// When the alarm being delivered was due and the time of the one before it.
+static uint64_t dispatch_due;
+static uint64_t last_dispatch;
+static uint32_t dispatches;
+
+void common_hal_mcu_disable_interrupts(void) {
+}
+
+void common_hal_mcu_enable_interrupts(void) {
+}
+
+bool timestamp_enabled(void) {
+    return true;
+}
+
+uint64_t timestamp_ticks(void) {
+    return now;
+}
+
+void timestamp_set_alarm_callback(void (*callback)(void)) {
+    alarm_callback = callback;
+}
+
+bool timestamp_set_alarm(uint64_t tick) {
+    CHECK(tick - now < (1ULL << 32));
+    alarm_armed = tick > now;
+    alarm_tick = tick;
+    return alarm_armed;
+}
+
+void timestamp_clear_alarm(void) {
+    alarm_armed = false;
+    alarm_pended = false;
+}
+
+void timestamp_pend_alarm(void) {
+    alarm_pended = true;
+}
+
+static uint64_t random_below(uint64_t limit) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state % limit;
+}
+
+static uint64_t round_up(uint64_t ticks) {
+    return (ticks + WHEEL_TICK - 1) & ~(WHEEL_TICK - 1);
+}
+
+static uint64_t random_delay(void) {
+    switch (random_below(4)) {
+        case 0:
+            return random_below(64 * WHEEL_TICK);
+        case 1:
+            return random_below(1ULL << 20);
+        case 2:
+            return random_below(1ULL << 28);
+        default:
+            // Past the last level so some get parked.
+            return random_below(1ULL << 36);
+    }
+}
+
+static void dispatch(void) {
+    uint64_t due = alarm_tick;
+    if (alarm_pended || due < now) {
+        due = now;
+    }
+    alarm_armed = false;
+    alarm_pended = false;
+    now = due;
+    if (random_below(8) == 0) {
+        now += random_below(4 * WHEEL_TICK);
+    }
+    dispatch_due = due;
+    in_alarm = true;
+    alarm_callback();
+    in_alarm = false;
+    last_dispatch = now;
+    dispatches++;
+}
+
+static void advance_to(uint64_t target) {
+    while (alarm_pended || (alarm_armed && alarm_tick <= target)) {
+        dispatch();
+    }
+    if (now < target) {
+        now = target;
+    }
+}
+
+static void start(test_timer_t* t, uint64_t delay, uint32_t period) {
+    t->since = now;
+    t->next = round_up(now + delay);
+    // The wheel tick an alarm ran in is done so timers due in it go in the next one.
+    if (dispatches != 0 && t->next <= last_dispatch) {
+        t->next = round_up(last_dispatch + 1);
+    }
+    t->period = round_up(period);
+    timer_wheel_start(&t->timer, delay, period);
+}
+
+static void expired(void* context) {
+    test_timer_t* t = context;
+    CHECK(in_alarm);
+    // Not early.
+    CHECK(now >= t->next);
+    // Not late: it wasn't due at the alarm before this one and the alarm wasn't set past it.
+    CHECK(t->next > last_dispatch || t->since >= last_dispatch);
+    CHECK(t->next >= dispatch_due);
+    t->expiries++;
+    if (t->period != 0) {
+        t->next += t->period;
+        if (t->expiries == PERIODIC_EXPIRIES) {
+            timer_wheel_cancel(&t->timer);
+        }
+    } else if (t->restart) {
+        t->restart = false;
+        // At least a wheel tick so it can't land on the tick being run.
+        start(t, WHEEL_TICK + random_delay(), 0);
+    }
+}
+
+int main(void) {
+    now = 12345;
+    CHECK(timer_wheel_init());
+    clock_t begin = clock();
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        test_timer_t* t = &timers[i];
+        advance_to(now + random_below(4096));
+        timer_wheel_timer_init(&t->timer, expired, t);
+        if (i % 3 == 0) {
+            t->expected_expiries = PERIODIC_EXPIRIES;
+            start(t, random_delay(), 1 + random_below(1 << 20));
+        } else {
+            t->expected_expiries = 1;
+            if (i % 7 == 0) {
+                t->restart = true;
+                t->expected_expiries = 2;
+            }
+            if (i % 13 == 0) {
+                // Already due so the alarm has to be pended rather than set.
+                advance_to(round_up(now));
+                start(t, 0, 0);
+            } else {
+                start(t, random_delay(), 0);
+            }
+            if (i % 11 == 0) {
+                timer_wheel_cancel(&t->timer);
+                t->expected_expiries = 0;
+            }
+        }
+    }
+    // Past the longest restarted delay and the longest periodic run.
+    advance_to(now + (1ULL << 38));
+    double elapsed = (double) (clock() - begin) / CLOCKS_PER_SEC;
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        CHECK(timers[i].expiries == timers[i].expected_expiries);
+        CHECK(!timer_wheel_active(&timers[i].timer));
+        total += timers[i].expiries;
+    }
+    CHECK(!alarm_armed && !alarm_pended);
+    timer_wheel_deinit();
+
+    printf("%u timer wheel expiries over %u alarms in %.1f ms\n", total, dispatches, elapsed * 1000);
+    if (failures != 0) {
+        printf("%d timer wheel checks failed\n", failures);
+        return 1;
+    }
+    printf("timer wheel checks passed\n");
+    return 0;
+}